@@ -2,7 +2,7 @@
 # Find the native FFTW-3 includes and library
 #
 #  FFTW3_INCLUDE_DIRS    - where to find fftw3.h
-#  FFTW3_LIBRARIES   - List of libraries when using FFTW.
+#  FFTW3_LIBRARIES   - List of libraries when using FFTW (double and single precision).
 #  FFTW3_FOUND       - True if FFTW found.
 
 if(FFTW3_INCLUDE_DIRS)
@@ -11,11 +11,15 @@ if(FFTW3_INCLUDE_DIRS)
 endif(FFTW3_INCLUDE_DIRS)
 
 find_path(FFTW3_INCLUDE_DIRS fftw3.h)
-find_library(FFTW3_LIBRARIES NAMES fftw3)
+find_library(FFTW3_DOUBLE_LIBRARY NAMES fftw3)
+find_library(FFTW3_FLOAT_LIBRARY NAMES fftw3f)
+if(FFTW3_DOUBLE_LIBRARY AND FFTW3_FLOAT_LIBRARY)
+  set(FFTW3_LIBRARIES ${FFTW3_DOUBLE_LIBRARY} ${FFTW3_FLOAT_LIBRARY})
+endif(FFTW3_DOUBLE_LIBRARY AND FFTW3_FLOAT_LIBRARY)
 
 # handle the QUIETLY and REQUIRED arguments and set FFTW3_FOUND to TRUE if
 # all listed variables are TRUE
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(FFTW3 DEFAULT_MSG FFTW3_LIBRARIES FFTW3_INCLUDE_DIRS)
 
-mark_as_advanced(FFTW3_LIBRARIES FFTW3_INCLUDE_DIRS)
+mark_as_advanced(FFTW3_LIBRARIES FFTW3_DOUBLE_LIBRARY FFTW3_FLOAT_LIBRARY FFTW3_INCLUDE_DIRS)
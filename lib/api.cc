@@ -1,4 +1,6 @@
 #include "api.hh"
+#include "exception.hh"
+#include <sstream>
 
 using namespace wt;
 
@@ -35,6 +37,32 @@ Wavelet::operator =(const Wavelet &other) {
   return *this;
 }
 
+Wavelet
+Wavelet::fromIdentifier(const std::string &identifier) {
+  // Split "Name(param=value)"
+  size_t open = identifier.find('('), assign = identifier.find('=');
+  if ((std::string::npos == open) || (std::string::npos == assign) || (assign < open) ||
+      (')' != identifier[identifier.size()-1])) {
+    ValueError err; err << "Invalid wavelet identifier '" << identifier << "'."; throw err;
+  }
+  std::string name = identifier.substr(0, open), param = identifier.substr(open+1, assign-open-1);
+  std::istringstream buffer(identifier.substr(assign+1, identifier.size()-assign-2));
+  double value; buffer >> value;
+  if (buffer.fail() || (! buffer.eof())) {
+    ValueError err; err << "Invalid parameter of wavelet identifier '" << identifier << "'.";
+    throw err;
+  }
+  if (("Morlet" == name) && ("dff" == param))
+    return Morlet(value);
+  if (("RegMorlet" == name) && ("dff" == param))
+    return RegMorlet(value);
+  if (("Cauchy" == name) && ("alpha" == param))
+    return Cauchy(value);
+  if (("RegCauchy" == name) && ("alpha" == param))
+    return RegCauchy(value);
+  ValueError err; err << "Unknown wavelet '" << identifier << "'."; throw err;
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of Morlet container
@@ -103,6 +103,32 @@ public:
     return _wavelet->cutOffFreq();
   }
 
+  /** Returns @c true if the Fourier transforms of the wavelet pair are known. */
+  inline bool hasSpectrum() const {
+    return _wavelet->hasSpectrum();
+  }
+
+  /** Evaluates the Fourier transform of the (unscaled) analysis wavelet at the specified
+   * frequency. */
+  inline std::complex<double> evalAnalysisSpectrum(const double &f) const {
+    return _wavelet->evalAnalysisSpectrum(f);
+  }
+
+  /** Evaluates the Fourier transform of the (unscaled) synthesis wavelet at the specified
+   * frequency. */
+  inline std::complex<double> evalSynthesisSpectrum(const double &f) const {
+    return _wavelet->evalSynthesisSpectrum(f);
+  }
+
+  /** Returns a string identifying the type and parameters of the wavelet (empty if unknown). */
+  inline std::string identifier() const {
+    return _wavelet->identifier();
+  }
+
+  /** Constructs the wavelet with the given @c identifier (see @c identifier). Throws a
+   * @c ValueError if the identifier is unknown. */
+  static Wavelet fromIdentifier(const std::string &identifier);
+
 protected:
   /** Holds a reference to the wavelet object. */
   WaveletObj *_wavelet;
@@ -0,0 +1,136 @@
+#ifndef __WT_BINARYIO_HH__
+#define __WT_BINARYIO_HH__
+
+#include "exception.hh"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+
+namespace wt {
+
+/** Marks the byte order of the host in binary files. Files are written in the native byte order
+ * and rejected if read on a host with a different one.
+ * @ingroup core */
+#define WT_BINARY_BYTE_ORDER uint32_t(0x01020304)
+
+/** Writes the raw bytes of @c n elements at @c data to the stream @c out. Throws an @c IOError
+ * on failure.
+ * @ingroup core */
+template <class T>
+inline void writeBinary(std::ostream &out, const T *data, size_t n) {
+  out.write(reinterpret_cast<const char *>(data), n*sizeof(T));
+  if (! out) {
+    IOError err; err << "Can not write " << n*sizeof(T) << " bytes."; throw err;
+  }
+}
+
+/** Writes the raw bytes of @c value to the stream @c out.
+ * @ingroup core */
+template <class T>
+inline void writeBinary(std::ostream &out, const T &value) {
+  writeBinary(out, &value, 1);
+}
+
+/** Writes the length of the string @c value followed by its characters to @c out.
+ * @ingroup core */
+inline void writeBinary(std::ostream &out, const std::string &value) {
+  writeBinary(out, uint64_t(value.size()));
+  writeBinary(out, value.data(), value.size());
+}
+
+/** Reads the raw bytes of @c n elements from the stream @c in into @c data. Throws an @c IOError
+ * if the stream ends prematurely.
+ * @ingroup core */
+template <class T>
+inline void readBinary(std::istream &in, T *data, size_t n) {
+  in.read(reinterpret_cast<char *>(data), n*sizeof(T));
+  if (! in) {
+    IOError err; err << "Unexpected end of file, can not read " << n*sizeof(T) << " bytes.";
+    throw err;
+  }
+}
+
+/** Reads the raw bytes of a value from the stream @c in.
+ * @ingroup core */
+template <class T>
+inline T readBinary(std::istream &in) {
+  T value; readBinary(in, &value, 1);
+  return value;
+}
+
+/** Returns the number of bytes left in the stream @c in or -1 if the stream is not seekable.
+ * @ingroup core */
+inline int64_t binaryBytesLeft(std::istream &in) {
+  std::streampos pos = in.tellg();
+  if (std::streampos(-1) == pos)
+    return -1;
+  in.seekg(0, std::ios::end);
+  std::streampos end = in.tellg();
+  in.clear(); in.seekg(pos);
+  if ((std::streampos(-1) == end) || (end < pos))
+    return -1;
+  return int64_t(end-pos);
+}
+
+/** Reads the number of elements of @c elementSize bytes following in the stream @c in. Throws
+ * an @c IOError if the stream is seekable and holds fewer bytes, i.e., before the elements get
+ * allocated.
+ * @ingroup core */
+inline uint64_t readBinarySize(std::istream &in, size_t elementSize) {
+  uint64_t n = readBinary<uint64_t>(in);
+  int64_t left = binaryBytesLeft(in);
+  if ((0 <= left) && (n > uint64_t(left)/elementSize)) {
+    IOError err; err << "Invalid file: " << n << " elements of " << elementSize
+                     << " bytes exceed the remaining " << left << " bytes.";
+    throw err;
+  }
+  return n;
+}
+
+/** Reads a string written by @c writeBinary from the stream @c in.
+ * @ingroup core */
+inline std::string readBinaryString(std::istream &in) {
+  uint64_t n = readBinarySize(in, 1);
+  std::string value(n, '\0');
+  if (n) readBinary(in, &value[0], n);
+  return value;
+}
+
+/** Writes the header of a binary file, i.e. the 4-character @c magic, the @c version of the
+ * format and the byte order of the host.
+ * @ingroup core */
+inline void writeBinaryHeader(std::ostream &out, const char *magic, uint32_t version) {
+  writeBinary(out, magic, 4);
+  writeBinary(out, version);
+  writeBinary(out, WT_BINARY_BYTE_ORDER);
+}
+
+/** Reads and checks the header of a binary file written by @c writeBinaryHeader. Throws an
+ * @c IOError if the magic or the byte order does not match or the version is newer than
+ * @c version. Returns the version of the file.
+ * @ingroup core */
+inline uint32_t readBinaryHeader(std::istream &in, const char *magic, uint32_t version) {
+  char fileMagic[4]; readBinary(in, fileMagic, 4);
+  if (0 != std::memcmp(fileMagic, magic, 4)) {
+    IOError err; err << "Invalid file format, expected '" << std::string(magic, 4) << "'.";
+    throw err;
+  }
+  uint32_t fileVersion = readBinary<uint32_t>(in);
+  if ((0 == fileVersion) || (fileVersion > version)) {
+    IOError err; err << "Unsupported version " << fileVersion << " of '"
+                     << std::string(magic, 4) << "' file, expected at most " << version << ".";
+    throw err;
+  }
+  if (WT_BINARY_BYTE_ORDER != readBinary<uint32_t>(in)) {
+    IOError err; err << "Can not read '" << std::string(magic, 4)
+                     << "' file written on a host with a different byte order.";
+    throw err;
+  }
+  return fileVersion;
+}
+
+}
+
+#endif // __WT_BINARYIO_HH__
@@ -0,0 +1,36 @@
+#ifndef __WT_BLOCKSINK_HH__
+#define __WT_BLOCKSINK_HH__
+
+#include "types.hh"
+
+
+namespace wt {
+
+/** Interface of a consumer of the output of a transform, receiving the result in blocks instead of
+ * a complete matrix. This allows to process (e.g., store or reduce) the results while they are
+ * still in the cache without the need to hold the complete result in memory.
+ *
+ * Each element of the result is passed exactly once. The blocks are passed in no particular
+ * order, possibly concurrently from several threads.
+ * @ingroup core */
+template <class Scalar>
+class GenericBlockSink
+{
+public:
+  /// Complex valued matrix type.
+  typedef typename Traits<Scalar>::CMatrix CMatrix;
+
+public:
+  /** Destructor. */
+  virtual ~GenericBlockSink() { }
+
+  /** Receives the @c block of the result starting at @c row and @c col. The block is only valid
+   * during the call. Needs to be implemented by all sinks. */
+  virtual void operator() (size_t row, size_t col, const Eigen::Ref<const CMatrix> &block) = 0;
+};
+
+typedef GenericBlockSink<double> BlockSink;
+
+}
+
+#endif // __WT_BLOCKSINK_HH__
@@ -0,0 +1,76 @@
+#include "convolution.hh"
+#include <cmath>
+
+using namespace wt;
+
+
+/* ******************************************************************************************** *
+ * Implementation of ConvolutionStrategy
+ * ******************************************************************************************** */
+ConvolutionStrategy::ConvolutionStrategy(size_t M, size_t K, size_t N, Algorithm algorithm,
+                                         bool analytic)
+  : _algorithm((AUTO == algorithm) ? OVERLAP_SAVE : algorithm), _fftSize(0), _blockLength(0),
+    _cost(0)
+{
+  // Smallest FFT size with blocks longer than the kernels
+  size_t Pmin = FFT<double>::roundUp(2*M);
+  // Largest FFT size to consider. If the signal length is known, the FFT of the complete
+  // signal. Otherwise, the costs per sample decrease only slightly beyond P=8M while the
+  // working memory (P x K) keeps growing, hence the FFT size is limited to 8M.
+  size_t Pmax = N ? FFT<double>::roundUp(N+M-1) : 4*Pmin;
+  // If the signal is short (e.g., N<2M), the whole-signal FFT is the only candidate
+  Pmin = std::min(Pmin, Pmax);
+
+  // For every FFT size, overlap-save is cheaper than overlap-add by (K-1)(M-1) (see cost), hence
+  // AUTO only selects the FFT size for overlap-save
+  double best = 0;
+  for (size_t P=Pmin; P<=Pmax; P=FFT<double>::roundUp(P+1)) {
+    double c = cost(M, K, N, P, _algorithm, analytic);
+    if ((0 == _fftSize) || (c < best)) {
+      best = c; _fftSize = P;
+    }
+  }
+  _blockLength = _fftSize-M+1;
+  _cost = best;
+
+  logDebug() << "Selected " << ((OVERLAP_SAVE == _algorithm) ? "overlap-save" : "overlap-add")
+             << " convolution with FFT size " << _fftSize << " for " << K
+             << " kernels of length " << M << ".";
+}
+
+double
+ConvolutionStrategy::cost(size_t M, size_t K, size_t N, size_t P, Algorithm algorithm,
+                          bool analytic)
+{
+  // Number of samples processed by each block
+  size_t L = P-M+1;
+  // Costs of one forward and K backward FFTs
+  double c = (K+1)*P*std::log2(double(P));
+  // Costs of the multiplication with the kernel spectra
+  c += K*(analytic ? (P/2+1) : P);
+  // Costs of storing the results
+  c += K*L;
+  // Costs of the overlaps: Overlap-add accumulates the tails of all K filtered blocks while
+  // overlap-save transforms M-1 samples of the signal twice.
+  if (OVERLAP_ADD == algorithm)
+    c += K*(M-1);
+  else
+    c += (M-1);
+  // Costs per sample or total costs
+  if (0 == N)
+    return c/L;
+  return c*((N+L-1)/L);
+}
+
+bool
+ConvolutionStrategy::merge(size_t M0, size_t M, size_t K, size_t m, bool analytic)
+{
+  if (M == m)
+    return true;
+  if (m > 2*M0)
+    return false;
+  double merged = ConvolutionStrategy(m, K+1, 0, AUTO, analytic).cost();
+  double separate = ConvolutionStrategy(M, K, 0, AUTO, analytic).cost()
+      + ConvolutionStrategy(m, 1, 0, AUTO, analytic).cost();
+  return merged <= separate;
+}
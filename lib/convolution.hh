@@ -3,20 +3,122 @@
 
 #include "types.hh"
 #include "fft.hh"
+#include "simd.hh"
+#include "exception.hh"
 #include "utils/logger.hh"
+#include <type_traits>
+#include <memory>
 
 namespace wt {
 
-/** Implements the overlap-add covolution\cite Smith2012 of a signal with several filter kernels
- * of the same size, each being shorter that the signal.
+/** Selects the algorithm and the block size of a block convolution.
  *
- * As all kernels share the same size, the forward FFT of a piece of the input signal must
- * be computed only once. This speeds up the convolution slightly. Further, assuming K kernels of
- * size M and a signal length of N samples. The direct FFT convolution cost would be
- * \f$(K+1)\,N\,\log(N)\f$, not including the costs of computing the FFTs of the kernels.
+ * Given K kernels of length M, a block of L samples of the signal is processed by an FFT of size
+ * \f$P\geq L+M-1\f$. Hence the costs of the convolution of a signal with N samples are
+ * approx. \f$\lceil N/L\rceil\,[(K+1)\,P\,\log_2(P) + K\,P]\f$. Small blocks (e.g., L=M) require
+ * many tiny FFTs while very large blocks waste effort for the zero-padding of the last block. The
+ * strategy selects the FFT size that minimizes these costs. If the signal length is known in
+ * advance, a single FFT of the whole signal is selected if it is cheaper than splitting it into
+ * blocks (e.g., if N<2M).
  *
- * Using the overlap-add method, the costs are \f$(K+1)\,N\,\log(2\,M)\f$, which results into a
- * benifit if \f$2\,M < N\f$. */
+ * Two block convolution algorithms are implemented. The overlap-add method \cite Smith2012
+ * transforms non-overlapping blocks of the signal and adds the overlapping tails of the
+ * filtered blocks. The overlap-save method transforms overlapping blocks of the signal and
+ * discards the parts of the filtered blocks affected by the circular convolution. For the same
+ * FFT size, both perform the same FFTs but the latter avoids the accumulation of the tails of
+ * all K filtered blocks. Hence the overlap-save method is always selected by @c AUTO, the
+ * overlap-add method is only kept for explicit selection and the streaming convolution (see
+ * @c GenericConvolution::applyStream). */
+class ConvolutionStrategy
+{
+public:
+  /** Possible block convolution algorithms. */
+  typedef enum {
+    AUTO,          ///< Selects overlap-save, the block size by the cost model.
+    OVERLAP_ADD,   ///< Overlap-add convolution.
+    OVERLAP_SAVE   ///< Overlap-save convolution.
+  } Algorithm;
+
+public:
+  /** Selects the algorithm and FFT size for the convolution of a signal with @c K kernels of
+   * length @c M. If the signal length @c N is not known in advance (N=0), the costs per sample
+   * are minimized. If @c analytic is @c true, only half of the spectra gets multiplied. The
+   * block size is selected for the given @c algorithm, where @c AUTO selects overlap-save. */
+  ConvolutionStrategy(size_t M, size_t K, size_t N=0, Algorithm algorithm=AUTO,
+                      bool analytic=false);
+
+  /** Returns the selected algorithm. */
+  inline Algorithm algorithm() const { return _algorithm; }
+  /** Returns the selected FFT size. */
+  inline size_t fftSize() const { return _fftSize; }
+  /** Returns the number of samples processed by each FFT. */
+  inline size_t blockLength() const { return _blockLength; }
+  /** Returns the estimated costs of the selected algorithm (per sample if the signal length is
+   * not known). */
+  inline double cost() const { return _cost; }
+
+  /** Returns the estimated costs for the convolution of @c N samples with @c K kernels of length
+   * @c M using an FFT of size @c P. If @c N=0, the costs per sample are returned. */
+  static double cost(size_t M, size_t K, size_t N, size_t P, Algorithm algorithm,
+                     bool analytic=false);
+
+  /** Returns @c true if a group of @c K kernels of length @c M should be merged with a kernel of
+   * length @c m>=M, i.e. if the convolution with K+1 kernels of length @c m is cheaper than two
+   * separate convolutions. Kernels longer than twice the shortest kernel @c M0 of the group are
+   * never merged. This bounds the zero-padding of the short kernels and keeps the groups (and
+   * their sub-sampling) of a grid spanning several octaves apart. */
+  static bool merge(size_t M0, size_t M, size_t K, size_t m, bool analytic=false);
+
+protected:
+  /** The selected algorithm. */
+  Algorithm _algorithm;
+  /** The selected FFT size. */
+  size_t _fftSize;
+  /** The number of samples processed by each FFT, i.e. @c _fftSize-M+1. */
+  size_t _blockLength;
+  /** The estimated costs. */
+  double _cost;
+};
+
+
+/** Possible quantities stored by the epilogue of a convolution. Except for @c OUTPUT_COMPLEX, the
+ * output is real valued, hence the modulus or phase of the result is obtained without an
+ * additional pass over a complex matrix. */
+typedef enum {
+  OUTPUT_COMPLEX,    ///< The complex result y.
+  OUTPUT_MODULUS,    ///< The modulus |y|.
+  OUTPUT_POWER,      ///< The power |y|^2.
+  OUTPUT_LOG_POWER,  ///< The natural logarithm of the power, log|y|^2.
+  OUTPUT_PHASE       ///< The phase arg(y) in [-pi, pi].
+} OutputMode;
+
+
+/** Implements the block covolution of a signal with several filter kernels of the same size.
+ *
+ * As all kernels share the same size, the forward FFT of a block of the input signal must
+ * be computed only once. This speeds up the convolution slightly. The block convolution algorithm
+ * (overlap-add or overlap-save) and the block size are selected by the @c ConvolutionStrategy.
+ *
+ * Real valued signals are transformed using a real-to-complex FFT, the negative frequencies
+ * are then obtained from the symmetry of the spectrum. If the convolution is constructed in the
+ * analytic mode, the negative frequencies of the kernels are assumed to vanish (e.g., for
+ * progressive wavelets like Morlet or Cauchy). Then only the non-negative half of the spectra
+ * is stored and multiplied.
+ *
+ * Several channels (the columns of the signal) can be convolved at once. The channels are
+ * processed in batches, where the forward FFTs of the blocks of all channels in a batch are
+ * performed at once.
+ *
+ * A convolution can also be constructed for the sum over several inputs: Given G inputs and K
+ * outputs, the kernel j of the input g is stored in the column g*K+j and the j-th output is the
+ * sum of the convolutions of all G inputs with their j-th kernel. The spectra of the filtered
+ * inputs are summed before a single backward FFT per output, hence the costs are those of a
+ * convolution with K kernels (plus G-1 forward FFTs). Then, each channel consists of G
+ * consecutive columns of the signal.
+ *
+ * Once constructed, the convolution (i.e. the kernel spectra) is not modified by its
+ * application. All scratch buffers are held by a @c Workspace, hence a single convolution
+ * can be applied concurrently using a separate workspace for each thread. */
 template <typename Scalar>
 class GenericConvolution
 {
@@ -27,57 +129,297 @@ public:
   typedef typename Traits<Scalar>::CVector CVector;
   /// Complex matrix type.
   typedef typename Traits<Scalar>::CMatrix CMatrix;
+  /// Real vector type.
+  typedef typename Traits<Scalar>::RVector RVector;
+  /// Real matrix type.
+  typedef typename Traits<Scalar>::RMatrix RMatrix;
+
+  /** Holds the scratch buffers and FFTs needed to apply a convolution. A workspace can be reused
+   * for several applications of the same convolution but must not be shared between threads. */
+  class Workspace
+  {
+  public:
+    /** Allocates the buffers for the application of @c conv to batches of @c channels. If
+     * @c kernels is not 0, only a tile of that many kernels is applied at once
+     * (see @c applyPart). */
+    Workspace(const GenericConvolution &conv, size_t channels=1, size_t kernels=0);
+
+    /** Returns the number of channels transformed at once. */
+    inline size_t channels() const { return this->_C/this->_G; }
+    /** Returns the number of kernels applied at once. */
+    inline size_t numKernels() const { return this->_K; }
+
+    /** Discards the tails of a stream (see @c applyStream), i.e. starts a new stream. */
+    void reset();
+
+  protected:
+    /** The number of summed inputs of each channel. */
+    size_t _G;
+    /** The number of signal columns (channels times inputs) transformed at once. */
+    size_t _C;
+    /** The number of kernels applied at once. */
+    size_t _K;
+    /** Working matrix for the forward-transforms of pieces of the input channels. */
+    CMatrix _part;
+    /** The in-place FFT transform of (zero-padded) signal parts. */
+    FFT<Scalar> _fwd;
+    /** Working matrix for the forward-transforms of pieces of real input channels, allocated on
+     * the first real-valued input. */
+    RMatrix _rpart;
+    /** The real-to-complex FFT of (zero-padded) real signal parts into @c _part, allocated on
+     * the first real-valued input. */
+    std::unique_ptr< FFT<Scalar> > _rfwd;
+    /** Overlapping tails of the back-transformed, filtered singals for every channel of a batch
+     * (overlap-add and streams only). */
+    CMatrix _lastRes;
+    /** The last sample of each filtered signal, needed for the interpolation. */
+    CVector _prev;
+    /** Working memory for backward transformation of filtered signals. */
+    CMatrix _work;
+    /** Backward transformation. */
+    FFT<Scalar> _rev;
+
+  private:
+    // Workspaces hold FFTs bound to their buffers, hence they can not be copied.
+    Workspace(const Workspace &other);
+    Workspace &operator=(const Workspace &other);
+
+    friend class GenericConvolution;
+  };
 
 public:
   /** Constructor. The complex matrix @c kernels specifies the convolution filters to be used.
-   * Every colum specifies a filter kernel. */
-  GenericConvolution(const Eigen::Ref<const CMatrix> &kernels, size_t subSample = 1);
+   * Every colum specifies a filter kernel. If @c analytic is @c true, the negative frequencies
+   * of the kernels are neglected. The block convolution @c algorithm and block size are
+   * selected by the @c ConvolutionStrategy, optionally using the expected signal length
+   * @c sizeHint. If @c inputs > 1, the kernels of the summed inputs are stored consecutively
+   * (see above), i.e. @c kernels has inputs*K columns. */
+  GenericConvolution(const Eigen::Ref<const CMatrix> &kernels, size_t subSample = 1,
+                     bool analytic = false,
+                     ConvolutionStrategy::Algorithm algorithm = ConvolutionStrategy::AUTO,
+                     size_t sizeHint = 0, size_t inputs = 1);
 
   /** Constructor. The complex matrix @c kernels specifies the convolution filters to be used.
    * Every colum specifies a filter kernel. */
-  GenericConvolution(const Complex *kernels, int Nrow, int Ncol, size_t subSample=1);
+  GenericConvolution(const Complex *kernels, int Nrow, int Ncol, size_t subSample=1,
+                     bool analytic=false,
+                     ConvolutionStrategy::Algorithm algorithm=ConvolutionStrategy::AUTO,
+                     size_t sizeHint=0, size_t inputs=1);
+
+  /** Constructor for @c K kernels (per input) of length @c M given in the frequency domain. The
+   * spectra of the kernels, i.e. the DFTs of the kernels zero-padded to @c fftSize() samples
+   * divided by @c fftSize(), must be stored into the columns of @c kernelSpectra() before the
+   * convolution gets applied. */
+  GenericConvolution(size_t M, size_t K, size_t subSample=1, bool analytic=false,
+                     ConvolutionStrategy::Algorithm algorithm=ConvolutionStrategy::AUTO,
+                     size_t sizeHint=0, size_t inputs=1);
+
+  /** Limits the kernels given by their spectra to @c kernelLength() samples. Spectra sampled
+   * from a closed-form Fourier transform describe kernels which are periodic in @c fftSize().
+   * Their tails would wrap into the neighbouring blocks, hence the result would depend on the
+   * blocking of the signal. The kernels are transformed back, the samples behind the kernel
+   * length are cleared and the kernels are transformed again. */
+  void limitKernels();
 
   /** Performs the convolution of the signal passed by @c signal with the kernels passed to the
-   * constructor. The results are stored in the columns of the array @c out. Hence, given a
-   * signal with N samples and K kernels, the output must be pre-allocated as a NxK array/matrix. */
+   * constructor using the given @c workspace. The results are stored in the columns of the array
+   * @c out. Hence, given a signal with N samples and K kernels, the output must be pre-allocated
+   * as a NxK array/matrix.
+   *
+   * If the signal has C columns (channels), the result of the j-th kernel applied to the c-th
+   * channel is stored in the column c*stride+j of @c out, where the @c stride defaults to K. If
+   * the inputs are summed, the signal has C*numInputs() columns. */
+  template <class iDerived, class oDerived>
+  void apply(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+             Workspace &workspace, size_t stride=0) const;
+  /** Performs the convolution using a temporary workspace. */
+  template <class iDerived, class oDerived>
+  void apply(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+             size_t stride=0) const;
+
+  /** Performs the convolution of the sub-sampled @c signal with the kernels and linearly
+   * interpolates the results by the factor @c subSampling() into the columns of @c out. That is,
+   * the i-th sample of the convolution is stored in row i*subSampling() of the output, the rows
+   * in-between are interpolated. The output must have at most signal.size()*subSampling() rows,
+   * excess samples are dropped. Several channels are stored like in @c apply. */
   template <class iDerived, class oDerived>
-  void apply(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out);
+  void applyInterpolated(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                         Workspace &workspace, size_t stride=0) const;
+  /** Performs the interpolated convolution using a temporary workspace. */
+  template <class iDerived, class oDerived>
+  void applyInterpolated(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                         size_t stride=0) const;
+
+  /** Performs a part of the convolution: Only the kernels [k0, k0+workspace.numKernels()) are
+   * applied and only the samples [s0, s1) of the result are stored (interpolated if
+   * @c interpolate is @c true). The results are stored at the same positions in @c out as by
+   * @c apply or @c applyInterpolated. Hence, the parts of a convolution can be computed
+   * independently, e.g. in parallel. Only the blocks of the signal contributing to these
+   * samples are transformed.
+   *
+   * If @c decimation > 1, only every @c decimation-th row of the (interpolated) result is
+   * computed and stored, i.e. row r of the result is stored in row r/decimation of @c out.
+   *
+   * If @c output is not @c OUTPUT_COMPLEX, @c out must be real valued and receives the selected
+   * quantity of the (interpolated) result. */
+  template <class iDerived, class oDerived>
+  void applyPart(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                 Workspace &workspace, size_t k0, ptrdiff_t s0, ptrdiff_t s1,
+                 bool interpolate=false, size_t stride=0, size_t decimation=1,
+                 OutputMode output=OUTPUT_COMPLEX) const;
+
+  /** Performs a part of the convolution like @c applyPart, but @c out holds only the rows
+   * [row0, row0+out.rows()) of the (decimated) result, which has @c nrows rows before the
+   * decimation. The samples [s0, s1) must not yield rows outside of @c out (see
+   * @c blockSamples). This allows to compute the result in small blocks. */
+  template <class iDerived, class oDerived>
+  void applyBlock(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                  Workspace &workspace, ptrdiff_t s0, ptrdiff_t s1, ptrdiff_t row0,
+                  ptrdiff_t nrows, bool interpolate=false, size_t stride=0,
+                  size_t decimation=1, OutputMode output=OUTPUT_COMPLEX) const;
+  /** Performs the convolution of the next block of a continuous, single-channel stream by
+   * overlap-add. The @c block holds at most @c blockLength() samples (one column per input),
+   * the tails of the previous blocks are kept in the @c workspace. The first block.rows()+M-1
+   * rows of @c out receive the samples of the full convolution (i.e., not shifted by M/2)
+   * starting at the first sample of the block. The first block.rows() of them are complete, the
+   * remaining ones lack the contributions of the following blocks. */
+  template <class iDerived, class oDerived>
+  void applyStream(const Eigen::DenseBase<iDerived> &block, Eigen::DenseBase<oDerived> &out,
+                   Workspace &workspace) const;
+
+  /** Returns the samples [s0, s1) yielding the rows [r0, r1) of the (interpolated) result with
+   * @c nrows rows. If @c interpolate is @c true, @c r0 and @c r1 (unless it equals @c nrows)
+   * must be multiples of the sub-sampling. */
+  void blockSamples(ptrdiff_t r0, ptrdiff_t r1, ptrdiff_t nrows, bool interpolate,
+                    ptrdiff_t &s0, ptrdiff_t &s1) const;
+
+  /** Returns the estimated costs of the part of the convolution of a signal of @c N samples with
+   * @c nk kernels, producing the samples [s0, s1). The costs are comparable to
+   * @c ConvolutionStrategy::cost. */
+  double partCost(size_t N, size_t nk, ptrdiff_t s0, ptrdiff_t s1) const;
 
   /** Returns the length of the kernels. */
   inline size_t kernelLength() const { return this->_M; }
-  /** Returns the number of kernels. */
+  /** Returns the number of kernels (per input). */
   inline size_t numKernels() const { return this->_K; }
+  /** Returns the number of samples processed by each FFT. */
+  inline size_t blockLength() const { return this->_L; }
+  /** Returns the number of summed inputs. */
+  inline size_t numInputs() const { return this->_inputs; }
 
   /** Returns the sub-sampling assinged to the convolution operation. */
   inline size_t subSampling() const { return _subSampling; }
   /** Sets the sub-sampling assinged to the convolution operation. */
   void setSubSampling(size_t subSample) { _subSampling = subSample; }
 
+  /** Returns @c true if the negative frequencies of the kernels are neglected. */
+  inline bool analytic() const { return _analytic; }
+  /** Returns the strategy (algorithm and block size) of the convolution. */
+  inline const ConvolutionStrategy &strategy() const { return _strategy; }
+  /** Returns the FFT size. */
+  inline size_t fftSize() const { return _P; }
+  /** Returns the spectra of the kernels, i.e. their DFTs divided by fftSize(). Hence the
+   * normalization of the backward FFT is folded into the kernels. In the analytic mode, only the
+   * non-negative frequencies (the first fftSize()/2+1 rows) are stored. The kernel j of the input
+   * g is stored in the column g*numKernels()+j. */
+  inline CMatrix &kernelSpectra() { return _kernelF; }
+  /** Returns the spectra of the kernels. */
+  inline const CMatrix &kernelSpectra() const { return _kernelF; }
+  /** Returns the frequency (in cycles per sample) of the @c i-th row of the kernel spectra. */
+  inline double frequency(size_t i) const {
+    return ((2*i <= _P) ? double(i) : (double(i)-double(_P)))/_P;
+  }
+
 protected:
-  /** The number of kernels. */
+  /** Computes the spectra of the @c n samples starting at @c first of the channels
+   * [c0, c0+nc) of the complex @c signal (zero-padded to the FFT size) and stores them into the
+   * columns of @c ws._part. Samples outside of the signal are considered to be zero. */
+  template <class iDerived>
+  void _forward(Workspace &ws, const Eigen::DenseBase<iDerived> &signal, ptrdiff_t first,
+                size_t n, size_t c0, size_t nc, std::true_type isComplex) const;
+  /** Computes the spectra of the @c n samples starting at @c first of the channels
+   * [c0, c0+nc) of the real @c signal using the real-to-complex FFT and stores them into the
+   * columns of @c ws._part. */
+  template <class iDerived>
+  void _forward(Workspace &ws, const Eigen::DenseBase<iDerived> &signal, ptrdiff_t first,
+                size_t n, size_t c0, size_t nc, std::false_type isComplex) const;
+  /** Multiplies the spectra of the inputs of the channel @c c of the batch in @c ws._part with
+   * the kernels starting at @c k0, sums them over the inputs and performs the backward FFT into
+   * @c ws._work. */
+  void _filter(Workspace &ws, size_t c, size_t k0) const;
+  /** Maps the samples of the convolution to the rows of the output. */
+  struct Rows {
+    /** The interpolation factor, i.e. the sample s is stored in the row s*subSample. */
+    ptrdiff_t subSample;
+    /** Only every decimation-th row is stored. */
+    ptrdiff_t decimation;
+    /** The (decimated) row of the result stored in the first row of the output. */
+    ptrdiff_t first;
+    /** The total number of rows of the (interpolated) result. */
+    ptrdiff_t count;
+    /** The quantity stored. */
+    OutputMode output;
+  };
+
+  /** Returns the range [first, last) of blocks needed to compute the samples [s0, s1) and, if
+   * interpolated by @c subSample > 1, the sample preceding @c s0. */
+  void _blocks(size_t N, ptrdiff_t s0, ptrdiff_t s1, size_t subSample,
+               size_t &first, size_t &last) const;
+  /** Performs the part of the convolution with the kernels starting at @c k0 and stores the
+   * samples [s0, s1) into the @c rows of @c out. */
+  template <class iDerived, class oDerived>
+  void _apply(Workspace &ws, const Eigen::DenseBase<iDerived> &signal,
+              Eigen::DenseBase<oDerived> &out, const Rows &rows, size_t stride, size_t k0,
+              ptrdiff_t s0, ptrdiff_t s1) const;
+  /** The epilogue of a block of the channel @c c of the current batch: Stores the @c n rows of
+   * @c ws._work starting at @c row as the samples starting at @c offset into the columns starting
+   * at @c col of @c out. In overlap-add mode, the tails of the previous block are added and the
+   * remaining rows are kept as the tails for the next block. All of this is done in a single
+   * sweep over each column of @c ws._work. */
+  template <class oDerived>
+  void _epilogue(Workspace &ws, Eigen::DenseBase<oDerived> &out, size_t col, size_t c,
+                 ptrdiff_t offset, size_t row, size_t n, const Rows &rows,
+                 ptrdiff_t s0, ptrdiff_t s1) const;
+  /** Stores the sample @c s into the column @c col of @c out. If interpolated, the rows between
+   * the previous sample @c prev and this sample are interpolated. Only every decimation-th row is
+   * stored (see @c Rows). Only the samples in [s0, s1) are stored, the sample s0-1 is only kept
+   * as @c prev. */
+  template <class oDerived>
+  static inline void _emit(Eigen::DenseBase<oDerived> &out, size_t col, ptrdiff_t s,
+                           const Complex &value, Complex &prev, const Rows &rows,
+                           ptrdiff_t s0, ptrdiff_t s1);
+  /** Stores the complex @c value into the complex element @c dest. */
+  template <class oScalar>
+  static inline void _store(oScalar &dest, const Complex &value, OutputMode output,
+                            std::true_type isComplex);
+  /** Stores the quantity @c output of the @c value into the real element @c dest. */
+  template <class oScalar>
+  static inline void _store(oScalar &dest, const Complex &value, OutputMode output,
+                            std::false_type isComplex);
+
+protected:
+  /** The number of kernels (per input). */
   size_t _K;
+  /** The number of summed inputs. */
+  size_t _inputs;
   /** The lenght of the kernels. */
   size_t _M;
+  /** The algorithm and block size. */
+  ConvolutionStrategy _strategy;
+  /** The FFT size. */
+  size_t _P;
+  /** The number of samples processed by each FFT. */
+  size_t _L;
   /** Holds the Fourier transformed of the kernels. */
   CMatrix _kernelF;
 
-  /** Working vector for the forward-transform of an piece of the input signal. */
-  CVector _part;
-  /** The in-place FFT transform of a (zero-padded) signal part. */
-  FFT<Scalar> _fwd;
-
-  /** Second halfs of the back-transformed, filtered singals. */
-  CMatrix _lastRes;
-  /** Working memory for backward transformation of filtered signals. */
-  CMatrix _work;
-  /** Backward transformation. */
-  FFT<Scalar> _rev;
-
   /** Possible subsampling for the convolution kernels.
    * This property of the convolution is not computed nor handled by the convolution itself,
    * instead it is a property that can be assigned to it. E.g., a kind of meta-data
    * for the convolution operation. */
   size_t _subSampling;
+  /** If @c true, only the non-negative frequencies of the kernels are considered. */
+  bool _analytic;
 };
 
 /// Complex convolution on double precision floats.
@@ -87,132 +429,546 @@ typedef GenericConvolution<double> Convolution;
 
 
 
+/* ********************************************************************************************* *
+ * Implementation of GenericConvolution::Workspace
+ * ********************************************************************************************* */
+template <class Scalar>
+wt::GenericConvolution<Scalar>::Workspace::Workspace(const GenericConvolution &conv, size_t channels,
+                                                     size_t kernels)
+  : _G(conv._inputs), _C(_G*std::max(channels, size_t(1))),
+    _K((0 == kernels) ? conv._K : std::min(kernels, conv._K)),
+    _part(conv._P, _C), _fwd(_part, FFT<Scalar>::FORWARD),
+    _rpart(), _rfwd(),
+    _lastRes((ConvolutionStrategy::OVERLAP_ADD == conv._strategy.algorithm()) ? conv._M-1 : 0,
+             _K*(_C/_G)),
+    _prev(_K*(_C/_G)), _work(conv._P, _K), _rev(_work, FFT<Scalar>::BACKWARD)
+{
+  // pass...
+}
+
+template <class Scalar>
+void
+wt::GenericConvolution<Scalar>::Workspace::reset() {
+  _lastRes.setConstant(0);
+  _prev.setConstant(0);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of GenericConvolution
  * ********************************************************************************************* */
 template <class Scalar>
-wt::GenericConvolution<Scalar>::GenericConvolution(const Eigen::Ref<const CMatrix> &kernels, size_t subSample)
-  : _K(kernels.cols()), _M(kernels.rows()),
-    _kernelF(2*_M, _K), _part(2*_M), _fwd(_part, FFT<Scalar>::FORWARD),
-    _lastRes(_M, _K), _work(2*_M, _K), _rev(_work, FFT<Scalar>::BACKWARD),
-    _subSampling(subSample)
+wt::GenericConvolution<Scalar>::GenericConvolution(const Eigen::Ref<const CMatrix> &kernels, size_t subSample, bool analytic,
+                                                   ConvolutionStrategy::Algorithm algorithm, size_t sizeHint,
+                                                   size_t inputs)
+  : _K(kernels.cols()/std::max(inputs, size_t(1))), _inputs(std::max(inputs, size_t(1))),
+    _M(kernels.rows()), _strategy(_M, _K, sizeHint, algorithm, analytic),
+    _P(_strategy.fftSize()), _L(_strategy.blockLength()), _kernelF(_P, _K*_inputs),
+    _subSampling(subSample), _analytic(analytic)
 {
-  logDebug() << "Construct FFT convolution of " << _K << " kernels with length " << _M << " each.";
+  logDebug() << "Construct FFT convolution of " << _K << " kernels with length " << _M << " each"
+             << " summed over " << _inputs << " input(s)"
+             << " using blocks of " << _L << " samples (FFT size " << _P << ").";
 
   // Store filter kernels:
   this->_kernelF.topRows(this->_M).noalias() = kernels;
-  this->_kernelF.bottomRows(this->_M).setConstant(0);
-  // Compute FFT in-place
+  this->_kernelF.bottomRows(this->_P-this->_M).setConstant(0);
+  // Compute FFT in-place and fold the normalization of the backward FFT into the kernels
   FFT<Scalar>::exec(this->_kernelF, FFT<Scalar>::FORWARD);
+  this->_kernelF /= Scalar(this->_P);
+  // Drop negative frequencies in analytic mode
+  if (this->_analytic)
+    this->_kernelF.conservativeResize(this->_P/2+1, this->_K*this->_inputs);
 }
 
 template <class Scalar>
-wt::GenericConvolution<Scalar>::GenericConvolution(const Complex *kernels, int Nrow, int Ncol, size_t subSample)
-  : _K(Ncol), _M(Nrow),
-    _kernelF(2*_M, _K), _part(2*_M), _fwd(_part, FFT<Scalar>::FORWARD),
-    _lastRes(_M, _K), _work(2*_M, _K), _rev(_work, FFT<Scalar>::BACKWARD),
-    _subSampling(subSample)
+wt::GenericConvolution<Scalar>::GenericConvolution(const Complex *kernels, int Nrow, int Ncol, size_t subSample, bool analytic,
+                                                   ConvolutionStrategy::Algorithm algorithm, size_t sizeHint,
+                                                   size_t inputs)
+  : _K(Ncol/std::max(inputs, size_t(1))), _inputs(std::max(inputs, size_t(1))), _M(Nrow),
+    _strategy(_M, _K, sizeHint, algorithm, analytic),
+    _P(_strategy.fftSize()), _L(_strategy.blockLength()), _kernelF(_P, _K*_inputs),
+    _subSampling(subSample), _analytic(analytic)
 {
   // Store filter kernels:
-  _kernelF.topRows(_M).noalias() = Eigen::Map<const CMatrix>(kernels, _M, _K);
-  _kernelF.bottomRows(_M).setConstant(0);
-  // Compute FFT in-place
+  _kernelF.topRows(_M).noalias() = Eigen::Map<const CMatrix>(kernels, _M, _K*_inputs);
+  _kernelF.bottomRows(_P-_M).setConstant(0);
+  // Compute FFT in-place and fold the normalization of the backward FFT into the kernels
   FFT<Scalar>::exec(_kernelF, FFT<Scalar>::FORWARD);
+  _kernelF /= Scalar(_P);
+  // Drop negative frequencies in analytic mode
+  if (_analytic)
+    _kernelF.conservativeResize(_P/2+1, _K*_inputs);
 }
 
 template <class Scalar>
-template <class iDerived, class oDerived>
-void
-wt::GenericConvolution<Scalar>::apply(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out)
+wt::GenericConvolution<Scalar>::GenericConvolution(size_t M, size_t K, size_t subSample, bool analytic,
+                                                   ConvolutionStrategy::Algorithm algorithm, size_t sizeHint,
+                                                   size_t inputs)
+  : _K(K), _inputs(std::max(inputs, size_t(1))), _M(M),
+    _strategy(_M, _K, sizeHint, algorithm, analytic),
+    _P(_strategy.fftSize()), _L(_strategy.blockLength()),
+    _kernelF(analytic ? (_P/2+1) : _P, _K*_inputs),
+    _subSampling(subSample), _analytic(analytic)
 {
-  // First, clear _lastRes matrix
-  this->_lastRes.setConstant(0);
+  logDebug() << "Construct FFT convolution of " << _K << " kernels with length " << _M << " each"
+             << " summed over " << _inputs << " input(s) from their spectra using blocks of " << _L
+             << " samples (FFT size " << _P << ").";
+}
 
-  /*
-   * Perform overlap-add FFT
-   */
-  size_t N = signal.size();
-  size_t steps = N/this->_M;
-  size_t rem   = N%this->_M;
-  size_t out_offset = 0;
+template <class Scalar>
+void
+wt::GenericConvolution<Scalar>::limitKernels() {
+  // In analytic mode, the negative frequencies are zero-padded
+  size_t n = this->_kernelF.rows();
+  CMatrix kernels(this->_P, this->_kernelF.cols());
+  kernels.topRows(n) = this->_kernelF;
+  kernels.bottomRows(this->_P-n).setConstant(0);
+  // The normalization is folded into the spectra, hence the backward FFT yields the kernels
+  FFT<Scalar>::exec(kernels, FFT<Scalar>::BACKWARD);
+  kernels.bottomRows(this->_P-this->_M).setConstant(0);
+  FFT<Scalar>::exec(kernels, FFT<Scalar>::FORWARD);
+  this->_kernelF = kernels.topRows(n)/Scalar(this->_P);
+}
 
-  // Compute the first complete steps
-  for (size_t i=0; i<steps; i++) {
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericConvolution<Scalar>::_forward(Workspace &ws, const Eigen::DenseBase<iDerived> &signal,
+                                         ptrdiff_t first, size_t n, size_t c0, size_t nc,
+                                         std::true_type) const
+{
+  // Determine the part of the block covered by the signal
+  ptrdiff_t a = std::max(first, ptrdiff_t(0));
+  ptrdiff_t b = std::max(a, std::min(first+ptrdiff_t(n), ptrdiff_t(signal.rows())));
+  for (size_t c=0; c<nc; c++) {
+    // 0-pad in front of the signal
+    ws._part.col(c).head(a-first).setConstant(0);
     // Store piece into forward-trafo buffer
-    this->_part.head(this->_M).noalias() =
-        signal.block(i*this->_M,0, _M,1).template cast<Complex>();
+    ws._part.col(c).segment(a-first, b-a).noalias() =
+        signal.block(a,c0+c, b-a,1).template cast<Complex>();
+    // 0-pad
+    ws._part.col(c).tail(this->_P-(b-first)).setConstant(0);
+  }
+  // Unused channels of the batch
+  ws._part.rightCols(ws._C-nc).setConstant(0);
+  // perform forward FFTs of all channels at once
+  ws._fwd.exec();
+}
+
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericConvolution<Scalar>::_forward(Workspace &ws, const Eigen::DenseBase<iDerived> &signal,
+                                         ptrdiff_t first, size_t n, size_t c0, size_t nc,
+                                         std::false_type) const
+{
+  // Allocate the real-to-complex FFT on first use, most workspaces transform complex inputs only
+  if (! ws._rfwd) {
+    ws._rpart.resize(this->_P, ws._C);
+    ws._rfwd.reset(new FFT<Scalar>(ws._rpart, ws._part));
+  }
+  // Determine the part of the block covered by the signal
+  ptrdiff_t a = std::max(first, ptrdiff_t(0));
+  ptrdiff_t b = std::max(a, std::min(first+ptrdiff_t(n), ptrdiff_t(signal.rows())));
+  for (size_t c=0; c<nc; c++) {
+    // 0-pad in front of the signal
+    ws._rpart.col(c).head(a-first).setConstant(0);
+    // Store piece into real forward-trafo buffer
+    ws._rpart.col(c).segment(a-first, b-a).noalias() =
+        signal.block(a,c0+c, b-a,1).template cast<Scalar>();
     // 0-pad
-    this->_part.tail(this->_M).setConstant(0);
+    ws._rpart.col(c).tail(this->_P-(b-first)).setConstant(0);
+  }
+  // Unused channels of the batch
+  ws._rpart.rightCols(ws._C-nc).setConstant(0);
+  // perform forward FFTs, the first P/2+1 frequencies are stored in _part
+  ws._rfwd->exec();
+  // Negative frequencies are not needed in analytic mode
+  if (this->_analytic)
+    return;
+  // Otherwise, reconstruct negative frequencies from the symmetry of the spectrum
+  size_t nneg = (this->_P-1)/2;
+  for (size_t c=0; c<nc; c++)
+    ws._part.col(c).tail(nneg) = ws._part.col(c).segment(1, nneg).reverse().conjugate();
+}
 
-    // perform forward FFT
-    this->_fwd.exec();
+template <class Scalar>
+void
+wt::GenericConvolution<Scalar>::_filter(Workspace &ws, size_t c, size_t k0) const
+{
+  // Multiply result of forward FFT of the signal piece with every (transformed) kernel, the
+  // products of further inputs are accumulated
+  size_t n = this->_analytic ? (this->_P/2+1) : this->_P;
+  for (size_t g=0; g<this->_inputs; g++) {
+    const Complex *part = ws._part.col(c*this->_inputs+g).data();
+    const Complex *kernels = this->_kernelF.col(g*this->_K+k0).data();
+    if (0 == g)
+      spectrumMultiply(part, kernels, this->_kernelF.rows(), ws._work.data(), ws._work.rows(),
+                       n, ws._K);
+    else
+      spectrumMultiplyAdd(part, kernels, this->_kernelF.rows(), ws._work.data(),
+                          ws._work.rows(), n, ws._K);
+  }
+  if (this->_analytic)
+    ws._work.bottomRows(this->_P-n).setConstant(0);
 
-    // Multiply result of forward FFT of the signal piece with every (transformed) kernel
-    for (size_t j=0; j<this->_K; j++) {
-      this->_work.col(j).noalias() =
-          this->_part.cwiseProduct(this->_kernelF.col(j));
-    }
+  // Peform backward trafo
+  ws._rev.exec();
+}
+
+template <class Scalar>
+template <class oDerived>
+inline void
+wt::GenericConvolution<Scalar>::_emit(Eigen::DenseBase<oDerived> &out, size_t col, ptrdiff_t s,
+                                      const Complex &value, Complex &prev, const Rows &rows,
+                                      ptrdiff_t s0, ptrdiff_t s1)
+{
+  typedef std::integral_constant<
+      bool, Eigen::NumTraits<typename oDerived::Scalar>::IsComplex> IsComplex;
+  ptrdiff_t D = rows.decimation;
+  if ((s < 0) || (s < (s0-1)) || (s >= s1))
+    return;
+  if (1 == rows.subSample) {
+    if ((s >= s0) && (0 == (s % D)))
+      _store(out.derived().coeffRef(s/D-rows.first, col), value, rows.output, IsComplex());
+    return;
+  }
+  // Interpolate the (stored) rows between the previous and this sample. The rows are
+  // contiguous within the column, the ramp is evaluated without divisions.
+  if ((s > 0) && (s >= s0)) {
+    ptrdiff_t r0 = (s-1)*rows.subSample;
+    ptrdiff_t r1 = std::min(r0+rows.subSample, rows.count);
+    ptrdiff_t first = D*WT_IDIV_CEIL(r0, D);
+    Complex delta = (value-prev)/Scalar(rows.subSample);
+    Complex current = prev + Scalar(first-r0)*delta, step = Scalar(D)*delta;
+    for (ptrdiff_t r=first; r<r1; r+=D, current+=step)
+      _store(out.derived().coeffRef(r/D-rows.first, col), current, rows.output, IsComplex());
+  }
+  prev = value;
+}
+
+template <class Scalar>
+template <class oScalar>
+inline void
+wt::GenericConvolution<Scalar>::_store(oScalar &dest, const Complex &value, OutputMode,
+                                       std::true_type)
+{
+  dest = oScalar(value);
+}
+
+template <class Scalar>
+template <class oScalar>
+inline void
+wt::GenericConvolution<Scalar>::_store(oScalar &dest, const Complex &value, OutputMode output,
+                                       std::false_type)
+{
+  switch (output) {
+  case OUTPUT_MODULUS: dest = oScalar(std::abs(value)); break;
+  case OUTPUT_POWER: dest = oScalar(std::norm(value)); break;
+  case OUTPUT_LOG_POWER: dest = oScalar(std::log(std::norm(value))); break;
+  case OUTPUT_PHASE: dest = oScalar(std::arg(value)); break;
+  default: dest = oScalar(value.real()); break;
+  }
+}
 
-    // Peform backward trafo
-    this->_rev.exec();
-
-    /*
-     * Compute result of convolution and store it into the output buffer
-     */
-    if (0 == out_offset) { // first block
-      out.topRows(this->_M/2).noalias() =
-          ( ( this->_work.block(this->_M/2, 0, this->_M/2, this->_K)
-              + this->_lastRes.topRows(this->_M/2) )/(2*this->_M) );
-      out_offset += ( this->_M/2 );
-    } else { // intermediate blocks
-      out.block(out_offset, 0, this->_M, this->_K).noalias() =
-          ( ( this->_work.topRows(this->_M) + this->_lastRes)/(2*this->_M) );
-      out_offset += this->_M;
+template <class Scalar>
+template <class oDerived>
+void
+wt::GenericConvolution<Scalar>::_epilogue(Workspace &ws, Eigen::DenseBase<oDerived> &out,
+                                          size_t col, size_t c, ptrdiff_t offset, size_t row,
+                                          size_t n, const Rows &rows, ptrdiff_t s0,
+                                          ptrdiff_t s1) const
+{
+  // The tails of a stream may be held with overlap-save too, hence the algorithm decides
+  bool save = (ConvolutionStrategy::OVERLAP_SAVE == this->_strategy.algorithm());
+  size_t T = ws._lastRes.rows();
+  for (size_t j=0; j<ws._K; j++) {
+    const Complex *work = ws._work.col(j).data();
+    Complex &prev = ws._prev(c*ws._K+j);
+    if (save) {
+      // Overlap-save: just store the valid rows
+      for (size_t r=0; r<n; r++)
+        _emit(out, col+j, offset+ptrdiff_t(r), work[row+r], prev, rows, s0, s1);
+      continue;
+    }
+    // Overlap-add: add the tails of the previous block to the first T rows, store the first n
+    // rows and keep the remaining ones. The tail at r-n has been consumed before it gets
+    // overwritten, hence this can be done in-place.
+    Complex *tail = ws._lastRes.col(c*ws._K+j).data();
+    for (size_t r=0; r<this->_P; r++) {
+      Complex value = work[r];
+      if (r < T)
+        value += tail[r];
+      if (r < n)
+        _emit(out, col+j, offset+ptrdiff_t(r), value, prev, rows, s0, s1);
+      else
+        tail[r-n] = value;
     }
-    // Store remaining part for next step unless we are at the last step
-    this->_lastRes.noalias() = this->_work.bottomRows(this->_M);
   }
+}
 
-  // Perform final step (if rem>0)
-  if (rem) {
-    // Store remaining samples
-    this->_part.head(rem).noalias() = signal.block(steps*this->_M,0, rem,1);
-    // 0-pad
-    this->_part.tail(2*this->_M-rem).setConstant(0);
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::apply(const Eigen::DenseBase<iDerived> &signal,
+                                      Eigen::DenseBase<oDerived> &out, Workspace &workspace,
+                                      size_t stride) const
+{
+  Rows rows = { 1, 1, 0, ptrdiff_t(out.rows()), OUTPUT_COMPLEX };
+  this->_apply(workspace, signal, out, rows, stride, 0, 0, signal.rows());
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::apply(const Eigen::DenseBase<iDerived> &signal,
+                                      Eigen::DenseBase<oDerived> &out, size_t stride) const
+{
+  Workspace workspace(*this);
+  Rows rows = { 1, 1, 0, ptrdiff_t(out.rows()), OUTPUT_COMPLEX };
+  this->_apply(workspace, signal, out, rows, stride, 0, 0, signal.rows());
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::applyInterpolated(const Eigen::DenseBase<iDerived> &signal,
+                                                  Eigen::DenseBase<oDerived> &out,
+                                                  Workspace &workspace, size_t stride) const
+{
+  ptrdiff_t subSample = std::max(this->_subSampling, size_t(1));
+  Rows rows = { subSample, 1, 0, ptrdiff_t(out.rows()), OUTPUT_COMPLEX };
+  this->_apply(workspace, signal, out, rows, stride, 0, 0, signal.rows());
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::applyInterpolated(const Eigen::DenseBase<iDerived> &signal,
+                                                  Eigen::DenseBase<oDerived> &out,
+                                                  size_t stride) const
+{
+  Workspace workspace(*this);
+  ptrdiff_t subSample = std::max(this->_subSampling, size_t(1));
+  Rows rows = { subSample, 1, 0, ptrdiff_t(out.rows()), OUTPUT_COMPLEX };
+  this->_apply(workspace, signal, out, rows, stride, 0, 0, signal.rows());
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::applyPart(const Eigen::DenseBase<iDerived> &signal,
+                                          Eigen::DenseBase<oDerived> &out, Workspace &workspace,
+                                          size_t k0, ptrdiff_t s0, ptrdiff_t s1, bool interpolate,
+                                          size_t stride, size_t decimation,
+                                          OutputMode output) const
+{
+  size_t subSample = interpolate ? std::max(this->_subSampling, size_t(1)) : 1;
+  decimation = std::max(decimation, size_t(1));
+  Rows rows = { ptrdiff_t(subSample), ptrdiff_t(decimation), 0,
+                ptrdiff_t(out.rows()*decimation), output };
+  this->_apply(workspace, signal, out, rows, stride, k0, s0, s1);
+}
 
-    // perform forward FFT
-    this->_fwd.exec();
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::applyBlock(const Eigen::DenseBase<iDerived> &signal,
+                                           Eigen::DenseBase<oDerived> &out, Workspace &workspace,
+                                           ptrdiff_t s0, ptrdiff_t s1, ptrdiff_t row0,
+                                           ptrdiff_t nrows, bool interpolate, size_t stride,
+                                           size_t decimation, OutputMode output) const
+{
+  size_t subSample = interpolate ? std::max(this->_subSampling, size_t(1)) : 1;
+  Rows rows = { ptrdiff_t(subSample), ptrdiff_t(std::max(decimation, size_t(1))), row0, nrows,
+                output };
+  this->_apply(workspace, signal, out, rows, stride, 0, s0, s1);
+}
 
-    // Multiply result of forward FFT of the signal piece with every (transformed) kernel
-    for (size_t j=0; j<this->_K; j++) {
-      this->_work.col(j).noalias() =
-          this->_part.cwiseProduct(this->_kernelF.col(j));
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::applyStream(const Eigen::DenseBase<iDerived> &block,
+                                            Eigen::DenseBase<oDerived> &out,
+                                            Workspace &ws) const
+{
+  typedef std::integral_constant<
+      bool, Eigen::NumTraits<typename iDerived::Scalar>::IsComplex> IsComplex;
+  size_t n = block.rows(), T = this->_M-1;
+  assertValue((n <= this->_L) && (size_t(block.cols()) == this->_inputs));
+  assertValue(ws._K == this->_K);
+  assertValue(size_t(out.rows()) >= (n+T));
+  // Overlap-save workspaces hold no tails, allocate them on first use
+  if (size_t(ws._lastRes.rows()) != T)
+    ws._lastRes.setZero(T, ws._K*(ws._C/ws._G));
+  // Transform the zero-padded block, filter and transform back
+  this->_forward(ws, block, 0, n, 0, this->_inputs, IsComplex());
+  this->_filter(ws, 0, 0);
+  // Add the tails of the previous blocks and keep the new ones. The tail at r-n has been
+  // consumed before it gets overwritten, hence this can be done in-place (see _epilogue).
+  for (size_t j=0; j<ws._K; j++) {
+    Complex *tail = ws._lastRes.col(j).data();
+    for (size_t r=0; r<(n+T); r++) {
+      Complex value = ws._work(r,j);
+      if (r < T)
+        value += tail[r];
+      out.derived().coeffRef(r, j) = value;
+      if (r >= n)
+        tail[r-n] = value;
     }
+  }
+}
+
+template <class Scalar>
+void
+wt::GenericConvolution<Scalar>::blockSamples(ptrdiff_t r0, ptrdiff_t r1, ptrdiff_t nrows,
+                                             bool interpolate, ptrdiff_t &s0, ptrdiff_t &s1) const
+{
+  ptrdiff_t S = interpolate ? std::max(this->_subSampling, size_t(1)) : 1;
+  if (1 == S) {
+    s0 = r0; s1 = r1;
+    return;
+  }
+  // The rows [(s-1)S, sS) are interpolated between the samples s-1 and s, the rows behind the
+  // last sample are emitted together with it.
+  s0 = r0/S + 1;
+  s1 = (r1 >= nrows) ? WT_IDIV_CEIL(nrows, S) : r1/S + 1;
+}
+
+template <class Scalar>
+void
+wt::GenericConvolution<Scalar>::_blocks(size_t N, ptrdiff_t s0, ptrdiff_t s1, size_t subSample,
+                                        size_t &first, size_t &last) const
+{
+  ptrdiff_t M = this->_M, L = this->_L, P = this->_P, shift = M/2;
+  ptrdiff_t steps = (ptrdiff_t(N)+L-1)/L;
+  // Also compute the sample s0-1 needed for the interpolation
+  ptrdiff_t a = std::max((1 < subSample) ? s0-1 : s0, ptrdiff_t(0));
+  ptrdiff_t b = std::min(s1, ptrdiff_t(N));
+  if (b <= a) {
+    first = last = 0;
+    return;
+  }
+  if (ConvolutionStrategy::OVERLAP_SAVE == this->_strategy.algorithm()) {
+    // The samples [iL, iL+L) are obtained from the i-th block
+    first = a/L;
+    last  = std::min(steps, (b-1)/L+1);
+    return;
+  }
+  // The i-th block contributes to the samples [iL-shift, iL-shift+P) and the samples
+  // [iL-shift, iL-shift+L) are complete after the i-th block
+  ptrdiff_t n = a+shift-(P-1);
+  first = (n <= 0) ? 0 : (n+L-1)/L;
+  last  = std::min(steps, (b-1+shift)/L+1);
+}
 
-    // Peform backward trafo
-    this->_rev.exec();
-
-    /// @bug Does not work if signal is shorter than kernel!!!
-    if (0 == steps) {
-      out.block(0, 0, rem, this->_K).noalias() =
-          this->_work.block(this->_M/2, 0, rem, this->_K) / (2*this->_M) ;
-    } else if (this->_M >= (rem+this->_M/2)) {
-      out.block(out_offset, 0, rem+this->_M/2, this->_K).noalias() =
-          ( ( this->_work.topRows(rem+this->_M/2) +
-              this->_lastRes.topRows(rem+this->_M/2) ) / (2*this->_M) );
+template <class Scalar>
+double
+wt::GenericConvolution<Scalar>::partCost(size_t N, size_t nk, ptrdiff_t s0, ptrdiff_t s1) const
+{
+  size_t first, last;
+  this->_blocks(N, s0, s1, this->_subSampling, first, last);
+  return ConvolutionStrategy::cost(this->_M, nk, (last-first)*this->_L, this->_P,
+                                   this->_strategy.algorithm(), this->_analytic);
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericConvolution<Scalar>::_apply(Workspace &ws, const Eigen::DenseBase<iDerived> &signal,
+                                       Eigen::DenseBase<oDerived> &out, const Rows &rows,
+                                       size_t stride, size_t k0, ptrdiff_t s0,
+                                       ptrdiff_t s1) const
+{
+  // Selects the complex or real forward transform of the signal
+  typedef std::integral_constant<
+      bool, Eigen::NumTraits<typename iDerived::Scalar>::IsComplex> IsComplex;
+
+  // The full convolution y[n] = sum_k h[k] x[n-k] gets shifted by M/2, i.e. out[t] = y[t+M/2],
+  // such that the kernels are centered.
+  // C channels of G summed inputs each, B channels per batch
+  size_t G = this->_inputs, N = signal.rows(), C = signal.cols()/G, B = ws._C/G;
+  size_t M = this->_M, L = this->_L, K = ws._K;
+  ptrdiff_t shift = M/2;
+  // Number of blocks
+  size_t steps = (N+L-1)/L;
+  // Number of samples to store (the output may be shorter than the signal)
+  ptrdiff_t nsamples = std::min(ptrdiff_t(N), WT_IDIV_CEIL(rows.count, rows.subSample));
+  s1 = std::min(s1, nsamples);
+  // Blocks needed for the samples [s0, s1)
+  size_t first, last;
+  this->_blocks(N, s0, s1, rows.subSample, first, last);
+  if (0 == stride)
+    stride = this->_K;
+
+  // Process channels in batches
+  for (size_t c0=0; c0<C; c0+=B) {
+    size_t nc = std::min(B, C-c0);
+
+    if (ConvolutionStrategy::OVERLAP_SAVE == this->_strategy.algorithm()) {
+      /*
+       * Perform overlap-save FFT: The FFT of the block starting at s-(M-1) yields the
+       * convolution y[s...s+L) in the last L rows.
+       */
+      for (size_t i=first; i<last; i++) {
+        // Transform zero-padded blocks of the channels
+        this->_forward(ws, signal, shift+ptrdiff_t(i*L)-ptrdiff_t(M-1), this->_P, c0*G, nc*G,
+                       IsComplex());
+        for (size_t c=0; c<nc; c++) {
+          // Filter and transform back
+          this->_filter(ws, c, k0);
+          // Store valid part of the circular convolution
+          this->_epilogue(ws, out, (c0+c)*stride+k0, c, i*L, M-1, L, rows, s0, s1);
+        }
+      }
     } else {
-      out.block(out_offset, 0, this->_M, this->_K).noalias() =
-          ( ( this->_work.topRows(this->_M) +
-              this->_lastRes.topRows(this->_M) ) / (2*this->_M) );
-      out_offset += this->_M;
-      size_t n = rem+this->_M/2-this->_M;
-      out.block(out_offset, 0, n, this->_K).noalias() =
-          (this->_work.block(this->_M, 0, n, this->_K) / (2*this->_M));
+      /*
+       * Perform overlap-add FFT: The FFT of the block starting at s yields the convolution
+       * y[s...s+P), where the last M-1 rows overlap with the next block.
+       */
+      // First, clear _lastRes matrix
+      ws._lastRes.setConstant(0);
+      for (size_t i=first; i<last; i++) {
+        // Transform zero-padded blocks of the channels
+        this->_forward(ws, signal, i*L, L, c0*G, nc*G, IsComplex());
+        for (size_t c=0; c<nc; c++) {
+          // Filter and transform back
+          this->_filter(ws, c, k0);
+          // Store the complete samples y[s...s+L) and keep the tails
+          this->_epilogue(ws, out, (c0+c)*stride+k0, c, ptrdiff_t(i*L)-shift, 0, L, rows,
+                          s0, s1);
+        }
+      }
+      // Store the remaining tails y[s...s+M-1)
+      for (size_t c=0; (c<nc) && (last == steps); c++) {
+        for (size_t j=0; j<K; j++) {
+          for (size_t r=0; r<(M-1); r++) {
+            _emit(out, (c0+c)*stride+k0+j, ptrdiff_t(steps*L)-shift+ptrdiff_t(r),
+                  ws._lastRes(r,c*K+j), ws._prev(c*K+j), rows, s0, s1);
+          }
+        }
+      }
+    }
+
+    // Interpolate the rows behind the last sample (also if only the preceding sample got
+    // computed, i.e. s0 == nsamples)
+    if ((1 < rows.subSample) && (0 < nsamples) && (s0 <= nsamples) && (s1 == nsamples)) {
+      typedef std::integral_constant<
+          bool, Eigen::NumTraits<typename oDerived::Scalar>::IsComplex> oIsComplex;
+      ptrdiff_t D = rows.decimation;
+      ptrdiff_t r0 = (nsamples-1)*rows.subSample;
+      ptrdiff_t r1 = std::min(r0+rows.subSample, rows.count);
+      Scalar S = rows.subSample;
+      for (size_t c=0; c<nc; c++) {
+        for (size_t j=0; j<K; j++) {
+          for (ptrdiff_t r=D*WT_IDIV_CEIL(r0, D); r<r1; r+=D) {
+            _store(out.derived().coeffRef(r/D-rows.first, (c0+c)*stride+k0+j),
+                   ws._prev(c*K+j)*((S-Scalar(r-r0))/S), rows.output, oIsComplex());
+          }
+        }
+      }
     }
-  } else {
-    // store last _M/2 samples if rem==0
-    out.block(out_offset, 0, this->_M/2, this->_K).noalias() =
-        ( this->_work.block(this->_M-rem, 0, this->_M/2, this->_K) / (2*this->_M) );
   }
 }
 
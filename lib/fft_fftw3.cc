@@ -1,92 +1,396 @@
 #include "fft_fftw3.hh"
+#include "utils/logger.hh"
 #include <iostream>
 #include <cmath>
+#include <map>
+#include <algorithm>
+#include <mutex>
 
 using namespace wt;
 
 
+/* ********************************************************************************************** *
+ * Internal state of the plan registry
+ * ********************************************************************************************** */
+namespace {
+
+/** Identifies a plan by the layout of the transform. */
+struct PlanKey
+{
+  int n, howmany, istride, idist, ostride, odist, sign;
+  bool inplace, real;
+  int ialign, oalign;
+
+  bool operator<(const PlanKey &other) const {
+    const int a[] = { n, howmany, istride, idist, ostride, odist, sign, inplace, real,
+                      ialign, oalign };
+    const int b[] = { other.n, other.howmany, other.istride, other.idist, other.ostride,
+                      other.odist, other.sign, other.inplace, other.real,
+                      other.ialign, other.oalign };
+    return std::lexicographical_compare(a, a+11, b, b+11);
+  }
+};
+
+/** Holds the plans of one precision and destroys them on exit. */
+template <class Scalar>
+struct PlanTable
+{
+  typedef typename FFTWApi<Scalar>::Plan Plan;
+
+  std::map<PlanKey, Plan> plans;
+  typename FFTPlanRegistry<Scalar>::Rigor rigor;
+
+  PlanTable() : plans(), rigor(FFTPlanRegistry<Scalar>::MEASURE) { }
+  ~PlanTable() {
+    typename std::map<PlanKey, Plan>::iterator item = plans.begin();
+    for (; item != plans.end(); item++) { FFTWApi<Scalar>::destroy(item->second); }
+  }
+
+  static PlanTable &get() {
+    static PlanTable table;
+    return table;
+  }
+};
+
+/** The FFTW3 planner is not thread-safe, this mutex guards any call to it. */
+std::mutex planner_lock;
+
+template <class Scalar>
+unsigned rigorFlags(typename FFTPlanRegistry<Scalar>::Rigor rigor) {
+  switch (rigor) {
+  case FFTPlanRegistry<Scalar>::ESTIMATE: return FFTW_ESTIMATE;
+  case FFTPlanRegistry<Scalar>::MEASURE: return FFTW_MEASURE;
+  case FFTPlanRegistry<Scalar>::PATIENT: return FFTW_PATIENT;
+  case FFTPlanRegistry<Scalar>::EXHAUSTIVE: return FFTW_EXHAUSTIVE;
+  }
+  return FFTW_ESTIMATE;
+}
+
+/** Number of elements spanned by @c howmany vectors of length @c n with the given strides. */
+inline size_t span(int n, int howmany, int stride, int dist) {
+  return size_t(n-1)*stride + size_t(howmany-1)*dist + 1;
+}
+
+}
+
+
+/* ********************************************************************************************** *
+ * Implementation of FFTPlanRegistry
+ * ********************************************************************************************** */
+template <class Scalar>
+typename FFTPlanRegistry<Scalar>::Plan
+FFTPlanRegistry<Scalar>::get(int n, int howmany, Complex *in, int istride, int idist,
+                             Complex *out, int ostride, int odist, int sign)
+{
+  typedef FFTWApi<Scalar> Api;
+  PlanKey key = { n, howmany, istride, idist, ostride, odist, sign, in == out, false,
+                  Api::alignment(in), Api::alignment(out) };
+
+  std::lock_guard<std::mutex> guard(planner_lock);
+  PlanTable<Scalar> &table = PlanTable<Scalar>::get();
+  typename std::map<PlanKey, Plan>::iterator item = table.plans.find(key);
+  if (item != table.plans.end())
+    return item->second;
+
+  // Plan on scratch memory with the same alignment as the actual arrays, hence measuring
+  // does not destroy the data and the plan can be applied to the actual arrays later.
+  size_t ilen = span(n, howmany, istride, idist), olen = span(n, howmany, ostride, odist);
+  char *ibuf = reinterpret_cast<char *>(Api::malloc(sizeof(Complex)*ilen + key.ialign));
+  char *obuf = key.inplace ? ibuf :
+      reinterpret_cast<char *>(Api::malloc(sizeof(Complex)*olen + key.oalign));
+  Complex *iscratch = reinterpret_cast<Complex *>(ibuf + key.ialign);
+  Complex *oscratch = reinterpret_cast<Complex *>(obuf + key.oalign);
+
+  logDebug() << "Create FFTW3 plan for " << howmany << " transforms of size " << n << ".";
+  Plan plan = Api::plan(n, howmany, iscratch, istride, idist, oscratch, ostride, odist,
+                        sign, rigorFlags<Scalar>(table.rigor));
+
+  Api::free(ibuf);
+  if (! key.inplace)
+    Api::free(obuf);
+
+  table.plans[key] = plan;
+  return plan;
+}
+
+template <class Scalar>
+typename FFTPlanRegistry<Scalar>::Plan
+FFTPlanRegistry<Scalar>::get(int n, int howmany, Scalar *in, int istride, int idist,
+                             Complex *out, int ostride, int odist)
+{
+  typedef FFTWApi<Scalar> Api;
+  PlanKey key = { n, howmany, istride, idist, ostride, odist, FFTW_FORWARD, false, true,
+                  Api::alignment(in), Api::alignment(out) };
+
+  std::lock_guard<std::mutex> guard(planner_lock);
+  PlanTable<Scalar> &table = PlanTable<Scalar>::get();
+  typename std::map<PlanKey, Plan>::iterator item = table.plans.find(key);
+  if (item != table.plans.end())
+    return item->second;
+
+  // Plan on scratch memory, see above.
+  size_t ilen = span(n, howmany, istride, idist), olen = span(n/2+1, howmany, ostride, odist);
+  char *ibuf = reinterpret_cast<char *>(Api::malloc(sizeof(Scalar)*ilen + key.ialign));
+  char *obuf = reinterpret_cast<char *>(Api::malloc(sizeof(Complex)*olen + key.oalign));
+  Scalar  *iscratch = reinterpret_cast<Scalar *>(ibuf + key.ialign);
+  Complex *oscratch = reinterpret_cast<Complex *>(obuf + key.oalign);
+
+  logDebug() << "Create FFTW3 r2c plan for " << howmany << " transforms of size " << n << ".";
+  Plan plan = Api::planR2C(n, howmany, iscratch, istride, idist, oscratch, ostride, odist,
+                           rigorFlags<Scalar>(table.rigor));
+
+  Api::free(ibuf);
+  Api::free(obuf);
+
+  table.plans[key] = plan;
+  return plan;
+}
+
+template <class Scalar>
+void
+FFTPlanRegistry<Scalar>::execOnce(int n, int howmany, Complex *in, int istride, int idist,
+                                  Complex *out, int ostride, int odist, int sign)
+{
+  typedef FFTWApi<Scalar> Api;
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> guard(planner_lock);
+    plan = Api::plan(n, howmany, in, istride, idist, out, ostride, odist, sign, FFTW_ESTIMATE);
+  }
+  Api::execute(plan, in, out);
+  std::lock_guard<std::mutex> guard(planner_lock);
+  Api::destroy(plan);
+}
+
+template <class Scalar>
+void
+FFTPlanRegistry<Scalar>::execOnce(int n, int howmany, Scalar *in, int istride, int idist,
+                                  Complex *out, int ostride, int odist)
+{
+  typedef FFTWApi<Scalar> Api;
+  Plan plan;
+  {
+    std::lock_guard<std::mutex> guard(planner_lock);
+    plan = Api::planR2C(n, howmany, in, istride, idist, out, ostride, odist, FFTW_ESTIMATE);
+  }
+  Api::execute(plan, in, out);
+  std::lock_guard<std::mutex> guard(planner_lock);
+  Api::destroy(plan);
+}
+
+template <class Scalar>
+typename FFTPlanRegistry<Scalar>::Rigor
+FFTPlanRegistry<Scalar>::rigor() {
+  std::lock_guard<std::mutex> guard(planner_lock);
+  return PlanTable<Scalar>::get().rigor;
+}
+
+template <class Scalar>
+void
+FFTPlanRegistry<Scalar>::setRigor(Rigor rigor) {
+  std::lock_guard<std::mutex> guard(planner_lock);
+  PlanTable<Scalar>::get().rigor = rigor;
+}
+
+template <class Scalar>
+size_t
+FFTPlanRegistry<Scalar>::size() {
+  std::lock_guard<std::mutex> guard(planner_lock);
+  return PlanTable<Scalar>::get().plans.size();
+}
+
+template <class Scalar>
+bool
+FFTPlanRegistry<Scalar>::importWisdom(const std::string &filename) {
+  std::lock_guard<std::mutex> guard(planner_lock);
+  if (! FFTWApi<Scalar>::importWisdom(filename.c_str())) {
+    logWarning() << "Cannot import FFTW3 wisdom from '" << filename << "'.";
+    return false;
+  }
+  logDebug() << "Imported FFTW3 wisdom from '" << filename << "'.";
+  return true;
+}
+
+template <class Scalar>
+bool
+FFTPlanRegistry<Scalar>::exportWisdom(const std::string &filename) {
+  std::lock_guard<std::mutex> guard(planner_lock);
+  if (! FFTWApi<Scalar>::exportWisdom(filename.c_str())) {
+    logWarning() << "Cannot export FFTW3 wisdom to '" << filename << "'.";
+    return false;
+  }
+  return true;
+}
+
+
 /* ********************************************************************************************** *
  * Implementation of FFT plan using FFTW3
  * ********************************************************************************************** */
-FFT<double>::FFT(CVector &in, CVector &out, Direction dir)
+template <class Scalar>
+FFT<Scalar>::FFT(CVector &in, CVector &out, Direction dir)
+  : _in(reinterpret_cast<FFTWComplex *>(in.data())), _rin(0),
+    _out(reinterpret_cast<FFTWComplex *>(out.data()))
 {
   assertShapeN(in, out.rows());
   assertShapeN(out, in.rows());
-  _plan = fftw_plan_dft_1d(
-        in.rows(),
-        reinterpret_cast<fftw_complex *>(in.data()),
-        reinterpret_cast<fftw_complex *>(out.data()),
-        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+  _plan = FFTPlanRegistry<Scalar>::get(
+        in.rows(), 1, _in, 1, in.rows(), _out, 1, out.rows(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
-FFT<double>::FFT(CVector &inout, Direction dir)
+template <class Scalar>
+FFT<Scalar>::FFT(CVector &inout, Direction dir)
+  : _in(reinterpret_cast<FFTWComplex *>(inout.data())), _rin(0), _out(_in)
 {
-  _plan = fftw_plan_dft_1d(
-        inout.rows(),
-        reinterpret_cast<fftw_complex *>(inout.data()),
-        reinterpret_cast<fftw_complex *>(inout.data()),
-        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+  _plan = FFTPlanRegistry<Scalar>::get(
+        inout.rows(), 1, _in, 1, inout.rows(), _out, 1, inout.rows(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
-FFT<double>::FFT(CMatrix &in, CMatrix &out, Direction dir) {
+template <class Scalar>
+FFT<Scalar>::FFT(CMatrix &in, CMatrix &out, Direction dir)
+  : _in(reinterpret_cast<FFTWComplex *>(in.data())), _rin(0),
+    _out(reinterpret_cast<FFTWComplex *>(out.data()))
+{
   assertShapeNM(in, out.rows(), out.cols());
+  _plan = FFTPlanRegistry<Scalar>::get(
+        in.rows(), in.cols(), _in, in.rowStride(), in.colStride(),
+        _out, out.rowStride(), out.colStride(),
+        (FORWARD == dir) ? FFTW_FORWARD : FFTW_BACKWARD);
+}
+
+template <class Scalar>
+FFT<Scalar>::FFT(CMatrix &inout, Direction dir)
+  : _in(reinterpret_cast<FFTWComplex *>(inout.data())), _rin(0), _out(_in)
+{
+  _plan = FFTPlanRegistry<Scalar>::get(
+        inout.rows(), inout.cols(), _in, inout.rowStride(), inout.colStride(),
+        _out, inout.rowStride(), inout.colStride(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
+}
+
+template <class Scalar>
+FFT<Scalar>::FFT(RVector &in, CVector &out)
+  : _in(0), _rin(in.data()), _out(reinterpret_cast<FFTWComplex *>(out.data()))
+{
+  assertValue(out.rows() >= (in.rows()/2+1));
+  _plan = FFTPlanRegistry<Scalar>::get(in.rows(), 1, _rin, 1, in.rows(), _out, 1, out.rows());
+}
 
-  int iRowStride = in.rowStride(),  iColStride = in.colStride();
-  int oRowStride = out.rowStride(), oColStride = out.colStride();
-  int n[1] = { int(in.rows()) };
-  _plan = fftw_plan_many_dft(
-        1, n, in.cols(),
-        reinterpret_cast<fftw_complex *>(in.data()), 0, iRowStride, iColStride,
-        reinterpret_cast<fftw_complex *>(out.data()), 0, oRowStride, oColStride,
-        (FORWARD == dir) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+template <class Scalar>
+FFT<Scalar>::FFT(RMatrix &in, CMatrix &out)
+  : _in(0), _rin(in.data()), _out(reinterpret_cast<FFTWComplex *>(out.data()))
+{
+  assertValue(out.rows() >= (in.rows()/2+1));
+  assertValue(out.cols() == in.cols());
+  _plan = FFTPlanRegistry<Scalar>::get(in.rows(), in.cols(), _rin, 1, in.rows(),
+                                       _out, 1, out.rows());
 }
 
-FFT<double>::FFT(CMatrix &inout, Direction dir) {
-  int n[1] = { int(inout.rows()) };
-  int rowStride = inout.rowStride(), colStride = inout.colStride();
-  _plan = fftw_plan_many_dft(
-        1, n, inout.cols(),
-        reinterpret_cast<fftw_complex *>(inout.data()), 0, rowStride, colStride,
-        reinterpret_cast<fftw_complex *>(inout.data()), 0, rowStride, colStride,
-        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD, FFTW_ESTIMATE);
+template <class Scalar>
+FFT<Scalar>::~FFT() {
+  // pass, plan is owned by the registry
 }
 
-FFT<double>::~FFT() {
-  fftw_destroy_plan(_plan);
+template <class Scalar>
+void
+FFT<Scalar>::exec() {
+  if (_rin)
+    FFTWApi<Scalar>::execute(_plan, _rin, _out);
+  else
+    FFTWApi<Scalar>::execute(_plan, _in, _out);
 }
 
+template <class Scalar>
 void
-FFT<double>::exec() {
-  fftw_execute(_plan);
+FFT<Scalar>::exec(CVector &in, CVector &out, Direction dir) {
+  assertShapeN(in, out.rows());
+  assertShapeN(out, in.rows());
+  FFTPlanRegistry<Scalar>::execOnce(
+        in.rows(), 1, reinterpret_cast<FFTWComplex *>(in.data()), 1, in.rows(),
+        reinterpret_cast<FFTWComplex *>(out.data()), 1, out.rows(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
+template <class Scalar>
 void
-FFT<double>::exec(CVector &in, CVector &out, Direction dir) {
-  FFT fft(in, out, dir);
-  fft.exec();
+FFT<Scalar>::exec(CMatrix &in, CMatrix &out, Direction dir) {
+  assertShapeNM(in, out.rows(), out.cols());
+  FFTPlanRegistry<Scalar>::execOnce(
+        in.rows(), in.cols(),
+        reinterpret_cast<FFTWComplex *>(in.data()), in.rowStride(), in.colStride(),
+        reinterpret_cast<FFTWComplex *>(out.data()), out.rowStride(), out.colStride(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
+template <class Scalar>
 void
-FFT<double>::exec(CMatrix &in, CMatrix &out, Direction dir) {
-  FFT fft(in, out, dir);
-  fft.exec();
+FFT<Scalar>::exec(CVector &inout, Direction dir) {
+  FFTWComplex *data = reinterpret_cast<FFTWComplex *>(inout.data());
+  FFTPlanRegistry<Scalar>::execOnce(
+        inout.rows(), 1, data, 1, inout.rows(), data, 1, inout.rows(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
+template <class Scalar>
 void
-wt::FFT<double>::exec(CVector &inout, Direction dir) {
-  FFT fft(inout, dir);
-  fft.exec();
+FFT<Scalar>::exec(CMatrix &inout, Direction dir) {
+  FFTWComplex *data = reinterpret_cast<FFTWComplex *>(inout.data());
+  FFTPlanRegistry<Scalar>::execOnce(
+        inout.rows(), inout.cols(), data, inout.rowStride(), inout.colStride(),
+        data, inout.rowStride(), inout.colStride(),
+        (dir == FORWARD) ? FFTW_FORWARD : FFTW_BACKWARD);
 }
 
+template <class Scalar>
 void
-FFT<double>::exec(CMatrix &inout, Direction dir) {
-  FFT fft(inout, dir);
-  fft.exec();
+FFT<Scalar>::exec(RVector &in, CVector &out) {
+  assertValue(out.rows() >= (in.rows()/2+1));
+  FFTPlanRegistry<Scalar>::execOnce(
+        in.rows(), 1, in.data(), 1, in.rows(),
+        reinterpret_cast<FFTWComplex *>(out.data()), 1, out.rows());
 }
 
+template <class Scalar>
 size_t
-FFT<double>::roundUp(size_t N) {
+FFT<Scalar>::roundUp(size_t N) {
   if (0 == N) { return 0; }
-  return std::pow(2, std::ceil(std::log2(N)));
+  // Relative costs (per sample and bit) of the FFTW3 codelets for the radices 2, 3, 5 and 7.
+  static const size_t radix[4] = { 2, 3, 5, 7 };
+  static const double efficiency[4] = { 1.0, 1.15, 1.3, 1.5 };
+  // The next power of 2 is always a candidate
+  size_t best = 1; while (best < N) { best *= 2; }
+  double bestCost = best*std::log2(double(best));
+  // Search all sizes 2^a 3^b 5^c 7^d in [N, best) for the one with the smallest costs
+  for (size_t n7=1; n7<best; n7*=7) {
+    for (size_t n5=n7; n5<best; n5*=5) {
+      for (size_t n3=n5; n3<best; n3*=3) {
+        size_t n = n3;
+        while (n < N) { n *= 2; }
+        if (n >= best) { continue; }
+        // Costs of the FFT of size n
+        double cost = 0;
+        size_t m = n;
+        for (int i=0; i<4; i++) {
+          for (; 0 == (m % radix[i]); m /= radix[i]) {
+            cost += efficiency[i]*std::log2(double(radix[i]));
+          }
+        }
+        cost *= n;
+        if (cost < bestCost) {
+          best = n; bestCost = cost;
+        }
+      }
+    }
+  }
+  return best;
 }
 
+
+/* ********************************************************************************************** *
+ * Explicit instantiation for double and single precision
+ * ********************************************************************************************** */
+template class wt::FFTPlanRegistry<double>;
+template class wt::FFTPlanRegistry<float>;
+template class wt::FFT<double>;
+template class wt::FFT<float>;
@@ -2,24 +2,205 @@
 #define __WT_FFT_FFTW3_HH__
 
 #include <fftw3.h>
+#include <string>
 #include "types.hh"
 #include "exception.hh"
 
 
 namespace wt {
 
-template <class Scalar> class FFT;
+/** Maps the FFTW3 API of the different precisions (fftw_* and fftwf_*) to a common interface.
+ * Only specialized for @c double and @c float. */
+template <class Scalar> class FFTWApi;
 
+/** The double precision FFTW3 API. */
+template <>
+class FFTWApi<double>
+{
+public:
+  /// The FFTW3 complex type.
+  typedef fftw_complex Complex;
+  /// The FFTW3 plan type.
+  typedef fftw_plan Plan;
 
-/** Implements the generic double precision FFT-plan interface for the FFTW3 library. */
+public:
+  /** Creates a plan for several 1D transforms. */
+  static inline Plan plan(int n, int howmany, Complex *in, int istride, int idist,
+                          Complex *out, int ostride, int odist, int sign, unsigned flags) {
+    return fftw_plan_many_dft(1, &n, howmany, in, 0, istride, idist, out, 0, ostride, odist,
+                              sign, flags);
+  }
+  /** Creates a plan for several real-to-complex 1D transforms. */
+  static inline Plan planR2C(int n, int howmany, double *in, int istride, int idist,
+                             Complex *out, int ostride, int odist, unsigned flags) {
+    return fftw_plan_many_dft_r2c(1, &n, howmany, in, 0, istride, idist, out, 0, ostride, odist,
+                                  flags);
+  }
+  /** Executes the given plan on the specified arrays. */
+  static inline void execute(const Plan plan, Complex *in, Complex *out) {
+    fftw_execute_dft(plan, in, out);
+  }
+  /** Executes the given real-to-complex plan on the specified arrays. */
+  static inline void execute(const Plan plan, double *in, Complex *out) {
+    fftw_execute_dft_r2c(plan, in, out);
+  }
+  /** Destroys a plan. */
+  static inline void destroy(Plan plan) { fftw_destroy_plan(plan); }
+  /** Returns the alignment offset of the given array. */
+  static inline int alignment(Complex *ptr) {
+    return fftw_alignment_of(reinterpret_cast<double *>(ptr));
+  }
+  /** Returns the alignment offset of the given real array. */
+  static inline int alignment(double *ptr) { return fftw_alignment_of(ptr); }
+  /** Allocates memory suitable for the FFTW3 planner. */
+  static inline void *malloc(size_t n) { return fftw_malloc(n); }
+  /** Frees memory allocated with @c malloc. */
+  static inline void free(void *ptr) { fftw_free(ptr); }
+  /** Imports the wisdom from the specified file. */
+  static inline bool importWisdom(const char *filename) {
+    return fftw_import_wisdom_from_filename(filename);
+  }
+  /** Exports the wisdom to the specified file. */
+  static inline bool exportWisdom(const char *filename) {
+    return fftw_export_wisdom_to_filename(filename);
+  }
+};
+
+/** The single precision FFTW3 API. */
 template <>
-class FFT<double>
+class FFTWApi<float>
+{
+public:
+  /// The FFTW3 complex type.
+  typedef fftwf_complex Complex;
+  /// The FFTW3 plan type.
+  typedef fftwf_plan Plan;
+
+public:
+  /** Creates a plan for several 1D transforms. */
+  static inline Plan plan(int n, int howmany, Complex *in, int istride, int idist,
+                          Complex *out, int ostride, int odist, int sign, unsigned flags) {
+    return fftwf_plan_many_dft(1, &n, howmany, in, 0, istride, idist, out, 0, ostride, odist,
+                               sign, flags);
+  }
+  /** Creates a plan for several real-to-complex 1D transforms. */
+  static inline Plan planR2C(int n, int howmany, float *in, int istride, int idist,
+                             Complex *out, int ostride, int odist, unsigned flags) {
+    return fftwf_plan_many_dft_r2c(1, &n, howmany, in, 0, istride, idist, out, 0, ostride, odist,
+                                   flags);
+  }
+  /** Executes the given plan on the specified arrays. */
+  static inline void execute(const Plan plan, Complex *in, Complex *out) {
+    fftwf_execute_dft(plan, in, out);
+  }
+  /** Executes the given real-to-complex plan on the specified arrays. */
+  static inline void execute(const Plan plan, float *in, Complex *out) {
+    fftwf_execute_dft_r2c(plan, in, out);
+  }
+  /** Destroys a plan. */
+  static inline void destroy(Plan plan) { fftwf_destroy_plan(plan); }
+  /** Returns the alignment offset of the given array. */
+  static inline int alignment(Complex *ptr) {
+    return fftwf_alignment_of(reinterpret_cast<float *>(ptr));
+  }
+  /** Returns the alignment offset of the given real array. */
+  static inline int alignment(float *ptr) { return fftwf_alignment_of(ptr); }
+  /** Allocates memory suitable for the FFTW3 planner. */
+  static inline void *malloc(size_t n) { return fftwf_malloc(n); }
+  /** Frees memory allocated with @c malloc. */
+  static inline void free(void *ptr) { fftwf_free(ptr); }
+  /** Imports the wisdom from the specified file. */
+  static inline bool importWisdom(const char *filename) {
+    return fftwf_import_wisdom_from_filename(filename);
+  }
+  /** Exports the wisdom to the specified file. */
+  static inline bool exportWisdom(const char *filename) {
+    return fftwf_export_wisdom_to_filename(filename);
+  }
+};
+
+
+/** Process-wide registry of FFTW3 plans.
+ *
+ * A plan is created only once for every distinct data layout, i.e. transform size, number of
+ * transforms, strides, direction and whether the transform is performed in-place. The plans are
+ * created on scratch memory (hence the planner may measure without destroying any data) and get
+ * executed on the actual arrays using the FFTW3 new-array interface. Therefore all @c FFT
+ * instances sharing the same layout share the same plan.
+ *
+ * Additionally, the registry allows to load and store the FFTW3 wisdom. Hence the planning costs
+ * must not be payed each time the process starts. The registry is instantiated for @c double
+ * and @c float, each precision has its own plans and wisdom. */
+template <class Scalar>
+class FFTPlanRegistry
+{
+public:
+  /// The FFTW3 complex type.
+  typedef typename FFTWApi<Scalar>::Complex Complex;
+  /// The FFTW3 plan type.
+  typedef typename FFTWApi<Scalar>::Plan Plan;
+
+  /** Specifies the rigor of the FFTW3 planner. */
+  typedef enum {
+    ESTIMATE,   ///< Heuristic plans, no measurement (fastest planning).
+    MEASURE,    ///< Measure several plans and select the fastest (default).
+    PATIENT,    ///< Measure a wider range of plans.
+    EXHAUSTIVE  ///< Measure all plans (slowest planning).
+  } Rigor;
+
+public:
+  /** Returns the plan for the FFT of @c howmany vectors of length @c n. The arrays @c in and
+   * @c out are only used to determine the alignment and whether the transform is performed
+   * in-place, they are neither modified nor bound to the plan. */
+  static Plan get(int n, int howmany, Complex *in, int istride, int idist,
+                  Complex *out, int ostride, int odist, int sign);
+  /** Returns the plan for the real-to-complex forward FFT of @c howmany real vectors of length
+   * @c n. Only the non-negative frequencies (n/2+1 elements) are stored into @c out. */
+  static Plan get(int n, int howmany, Scalar *in, int istride, int idist,
+                  Complex *out, int ostride, int odist);
+
+  /** Executes a transient (not registered) plan on the given arrays once. The plan is created
+   * with FFTW_ESTIMATE (or from wisdom), hence the arrays are not overwritten by the planner. */
+  static void execOnce(int n, int howmany, Complex *in, int istride, int idist,
+                       Complex *out, int ostride, int odist, int sign);
+  /** Executes a transient real-to-complex plan on the given arrays once. */
+  static void execOnce(int n, int howmany, Scalar *in, int istride, int idist,
+                       Complex *out, int ostride, int odist);
+
+  /** Returns the rigor used for new plans. */
+  static Rigor rigor();
+  /** Sets the rigor used for new plans. Plans already held by the registry are not affected. */
+  static void setRigor(Rigor rigor);
+
+  /** Returns the number of plans held by the registry. */
+  static size_t size();
+
+  /** Loads the FFTW3 wisdom from the specified file. Returns @c false on error. */
+  static bool importWisdom(const std::string &filename);
+  /** Saves the accumulated FFTW3 wisdom into the specified file. Returns @c false on error. */
+  static bool exportWisdom(const std::string &filename);
+};
+
+
+/** Implements the generic FFT-plan interface for the FFTW3 library. The interface is
+ * instantiated for double (fftw) and single (fftwf) precision. The actual plans are obtained
+ * from the @c FFTPlanRegistry. */
+template <class Scalar>
+class FFT
 {
 public:
   /// The complex vector type.
-  typedef typename Traits<double>::CVector CVector;
+  typedef typename Traits<Scalar>::CVector CVector;
   /// The complex matrix type.
-  typedef typename Traits<double>::CMatrix CMatrix;
+  typedef typename Traits<Scalar>::CMatrix CMatrix;
+  /// The real vector type.
+  typedef typename Traits<Scalar>::RVector RVector;
+  /// The real matrix type.
+  typedef typename Traits<Scalar>::RMatrix RMatrix;
+  /// The FFTW3 complex type.
+  typedef typename FFTWApi<Scalar>::Complex FFTWComplex;
+  /// The FFTW3 plan type.
+  typedef typename FFTWApi<Scalar>::Plan FFTWPlan;
 
 public:
   /** Specifies the possible FFT directions. */
@@ -38,6 +219,12 @@ public:
   FFT(CVector &inout, Direction dir);
   /** Construts the in-place FFT of the column vectors @c inout. */
   FFT(CMatrix &inout, Direction dir);
+  /** Constructs the real-to-complex forward FFT of the real vector @c in. Only the non-negative
+   * frequencies are stored into the first N/2+1 elements of @c out. */
+  FFT(RVector &in, CVector &out);
+  /** Constructs the real-to-complex forward FFT of the real column vectors @c in. The
+   * non-negative frequencies are stored into the first N/2+1 rows of the columns of @c out. */
+  FFT(RMatrix &in, CMatrix &out);
 
   /** Destructor. */
   virtual ~FFT();
@@ -55,14 +242,24 @@ public:
   static void exec(CVector &inout, Direction dir);
   /** Executes the in-place FFT of the column vectors @c inout. */
   static void exec(CMatrix &inout, Direction dir);
+  /** Executes the real-to-complex forward FFT of the real vector @c in and stores the
+   * non-negative frequencies into the first N/2+1 elements of @c out. */
+  static void exec(RVector &in, CVector &out);
 
-  /** Computes the smallest samples size larger than or equal to @c N for which the FFT can be
-   * computed fast. */
+  /** Computes a samples size larger than or equal to @c N for which the FFT can be computed
+   * fast. The size is of the form \f$2^a\,3^b\,5^c\,7^d\f$ and minimizes the estimated costs
+   * of the FFT, taking the relative efficiency of the radices into account. */
   static size_t roundUp(size_t N);
 
 protected:
-  /** The actual FFTW3 plan being executed. */
-  fftw_plan _plan;
+  /** The actual FFTW3 plan being executed, owned by the @c FFTPlanRegistry. */
+  FFTWPlan _plan;
+  /** The input array (complex transforms). */
+  FFTWComplex *_in;
+  /** The input array (real-to-complex transforms). */
+  Scalar *_rin;
+  /** The output array. */
+  FFTWComplex *_out;
 };
 
 }
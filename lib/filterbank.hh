@@ -0,0 +1,245 @@
+#ifndef __WT_FILTERBANK_HH__
+#define __WT_FILTERBANK_HH__
+
+#include "convolution.hh"
+#include "filterbankcache.hh"
+#include "exception.hh"
+#include "binaryio.hh"
+#include <vector>
+#include <memory>
+
+
+namespace wt {
+
+/** A bank of block convolutions, each holding a group of kernels of the same size.
+ *
+ * The kernels of the j-th group yield the columns [offset(j), offset(j)+group(j).numKernels())
+ * of the result. Once built, a filter bank is not modified anymore. Hence it can be shared
+ * between any number of analyses and threads, where each thread uses its own @c Workspace, and
+ * held by the @c FilterBankCache.
+ *
+ * A filter bank can be saved to a binary stream (see @c save) holding the kernel spectra, the
+ * layout of the groups, their sub-sampling and the delays of the kernels. Loading it avoids the
+ * evaluation of the kernels and their FFTs.
+ * @ingroup analyses */
+template <class Scalar>
+class GenericFilterBank: public FilterBankCache::Item
+{
+public:
+  /// The convolution type of a group of kernels.
+  typedef GenericConvolution<Scalar> Group;
+  /// Complex matrix type.
+  typedef typename Group::CMatrix CMatrix;
+
+  /** Holds the workspaces of all groups of a filter bank. The workspace of a group is allocated
+   * on first use. A workspace must not be shared between threads. */
+  class Workspace
+  {
+  public:
+    /** Constructs a workspace for the given filter @c bank, transforming batches of
+     * @c channels. */
+    Workspace(const GenericFilterBank &bank, size_t channels=1);
+
+    /** Returns the number of channels transformed at once. */
+    inline size_t channels() const { return _channels; }
+
+    /** Returns the workspace of the @c j-th group. */
+    typename Group::Workspace &operator[] (size_t j);
+    /** Returns the workspace of the @c j-th group for applying tiles of @c kernels at once (see
+     * @c GenericConvolution::applyPart). If @c kernels is 0, all kernels are applied at once. */
+    typename Group::Workspace &get(size_t j, size_t kernels);
+
+  protected:
+    /** The filter bank. */
+    const GenericFilterBank &_bank;
+    /** The number of channels transformed at once. */
+    size_t _channels;
+    /** The workspaces of the groups. */
+    std::vector< std::unique_ptr<typename Group::Workspace> > _groups;
+  };
+
+public:
+  /** Constructs an empty filter bank. */
+  GenericFilterBank();
+  /** Loads a filter bank saved by @c save from the stream @c in. Throws an @c IOError if the
+   * stream does not hold a filter bank of the same precision or if the block sizes selected for
+   * the stored groups differ (e.g., if the filter bank was saved by an incompatible version). */
+  GenericFilterBank(std::istream &in);
+
+  /** Appends a @c group of kernels, the filter bank takes the ownership of the group. The
+   * delays of its kernels are 0. */
+  void add(Group *group);
+  /** Appends a @c group of kernels together with the (group-) @c delays of its kernels, the
+   * filter bank takes the ownership of the group. */
+  void add(Group *group, const Eigen::Ref<const Eigen::VectorXd> &delays);
+
+  /** Returns the number of groups. */
+  inline size_t numGroups() const { return _groups.size(); }
+  /** Returns the @c j-th group. */
+  inline const Group &group(size_t j) const { return *_groups[j]; }
+  /** Returns the first result column of the @c j-th group. */
+  inline size_t offset(size_t j) const { return _offsets[j]; }
+  /** Returns the total number of kernels. */
+  inline size_t numKernels() const { return _K; }
+  /** Returns the delays of all kernels. */
+  inline const Eigen::VectorXd &delays() const { return _delays; }
+
+  /** Returns the memory held by the kernel spectra in bytes. */
+  virtual size_t memory() const;
+
+  /** Saves the filter bank to the stream @c out in the native byte order. Throws an @c IOError
+   * on failure. */
+  void save(std::ostream &out) const;
+
+protected:
+  /** The groups of kernels. */
+  std::vector< std::unique_ptr<const Group> > _groups;
+  /** The first result column of each group. */
+  std::vector<size_t> _offsets;
+  /** The total number of kernels. */
+  size_t _K;
+  /** The delays of all kernels. */
+  Eigen::VectorXd _delays;
+};
+
+typedef GenericFilterBank<double> FilterBank;
+
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericFilterBank::Workspace
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericFilterBank<Scalar>::Workspace::Workspace(const GenericFilterBank &bank, size_t channels)
+  : _bank(bank), _channels(channels), _groups(bank.numGroups())
+{
+  // pass...
+}
+
+template <class Scalar>
+typename wt::GenericFilterBank<Scalar>::Group::Workspace &
+wt::GenericFilterBank<Scalar>::Workspace::operator[] (size_t j) {
+  return this->get(j, 0);
+}
+
+template <class Scalar>
+typename wt::GenericFilterBank<Scalar>::Group::Workspace &
+wt::GenericFilterBank<Scalar>::Workspace::get(size_t j, size_t kernels) {
+  if ((0 == kernels) || (kernels > _bank.group(j).numKernels()))
+    kernels = _bank.group(j).numKernels();
+  // (Re-) Allocate workspace if the tile size changed
+  if ((! _groups[j]) || (kernels != _groups[j]->numKernels()))
+    _groups[j].reset(new typename Group::Workspace(_bank.group(j), _channels, kernels));
+  return *_groups[j];
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericFilterBank
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericFilterBank<Scalar>::GenericFilterBank()
+  : _groups(), _offsets(), _K(0), _delays()
+{
+  // pass...
+}
+
+/** The version of the binary format of filter banks. */
+#define WT_FILTERBANK_VERSION uint32_t(1)
+
+template <class Scalar>
+wt::GenericFilterBank<Scalar>::GenericFilterBank(std::istream &in)
+  : _groups(), _offsets(), _K(0), _delays()
+{
+  readBinaryHeader(in, "WTFB", WT_FILTERBANK_VERSION);
+  if (sizeof(Scalar) != readBinary<uint32_t>(in)) {
+    IOError err; err << "Can not load filter bank of different precision."; throw err;
+  }
+  uint64_t numGroups = readBinary<uint64_t>(in);
+  for (uint64_t j=0; j<numGroups; j++) {
+    uint64_t M = readBinary<uint64_t>(in), K = readBinary<uint64_t>(in);
+    uint64_t inputs = readBinary<uint64_t>(in), subSampling = readBinary<uint64_t>(in);
+    bool analytic = readBinary<uint8_t>(in);
+    ConvolutionStrategy::Algorithm algorithm =
+        ConvolutionStrategy::Algorithm(readBinary<uint32_t>(in));
+    uint64_t P = readBinary<uint64_t>(in);
+    if ((0 == M) || (0 == K) || (0 == inputs) || (0 == subSampling) || (P < M) ||
+        ((ConvolutionStrategy::OVERLAP_ADD != algorithm) &&
+         (ConvolutionStrategy::OVERLAP_SAVE != algorithm))) {
+      IOError err; err << "Can not load group " << j << " of filter bank: Invalid layout.";
+      throw err;
+    }
+    // The delays and spectra must be held by the stream, check before allocating them
+    int64_t left = binaryBytesLeft(in);
+    double rows = analytic ? (P/2+1) : P;
+    double bytes = rows*double(K)*double(inputs)*sizeof(typename Group::Complex)
+        + double(K)*sizeof(double);
+    if ((0 <= left) && (bytes > double(left))) {
+      IOError err; err << "Can not load group " << j << " of filter bank: " << K << "x" << inputs
+                       << " kernels of length " << M << " exceed the remaining " << left
+                       << " bytes.";
+      throw err;
+    }
+    // The strategy is selected deterministically, only the algorithm must be fixed
+    std::unique_ptr<Group> group(new Group(M, K, subSampling, analytic, algorithm, 0, inputs));
+    if (group->fftSize() != P) {
+      IOError err; err << "Can not load group " << j << " of filter bank: FFT size " << P
+                       << " differs from the selected size " << group->fftSize() << ".";
+      throw err;
+    }
+    Eigen::VectorXd delays(K);
+    readBinary(in, delays.data(), K);
+    CMatrix &spectra = group->kernelSpectra();
+    readBinary(in, spectra.data(), spectra.size());
+    this->add(group.release(), delays);
+  }
+}
+
+template <class Scalar>
+void
+wt::GenericFilterBank<Scalar>::save(std::ostream &out) const {
+  writeBinaryHeader(out, "WTFB", WT_FILTERBANK_VERSION);
+  writeBinary(out, uint32_t(sizeof(Scalar)));
+  writeBinary(out, uint64_t(_groups.size()));
+  for (size_t j=0; j<_groups.size(); j++) {
+    const Group &group = *_groups[j];
+    writeBinary(out, uint64_t(group.kernelLength()));
+    writeBinary(out, uint64_t(group.numKernels()));
+    writeBinary(out, uint64_t(group.numInputs()));
+    writeBinary(out, uint64_t(group.subSampling()));
+    writeBinary(out, uint8_t(group.analytic()));
+    writeBinary(out, uint32_t(group.strategy().algorithm()));
+    writeBinary(out, uint64_t(group.fftSize()));
+    writeBinary(out, _delays.data()+_offsets[j], group.numKernels());
+    writeBinary(out, group.kernelSpectra().data(), group.kernelSpectra().size());
+  }
+}
+
+template <class Scalar>
+void
+wt::GenericFilterBank<Scalar>::add(Group *group) {
+  this->add(group, Eigen::VectorXd::Zero(group->numKernels()));
+}
+
+template <class Scalar>
+void
+wt::GenericFilterBank<Scalar>::add(Group *group, const Eigen::Ref<const Eigen::VectorXd> &delays) {
+  assertValue(size_t(delays.size()) == group->numKernels());
+  _delays.conservativeResize(_K+delays.size());
+  _delays.tail(delays.size()) = delays;
+  _offsets.push_back(_K);
+  _K += group->numKernels();
+  _groups.push_back(std::unique_ptr<const Group>(group));
+}
+
+template <class Scalar>
+size_t
+wt::GenericFilterBank<Scalar>::memory() const {
+  size_t bytes = 0;
+  for (size_t j=0; j<_groups.size(); j++)
+    bytes += _groups[j]->kernelSpectra().size()*sizeof(typename Group::Complex);
+  return bytes;
+}
+
+#endif // __WT_FILTERBANK_HH__
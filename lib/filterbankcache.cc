@@ -0,0 +1,143 @@
+#include "filterbankcache.hh"
+#include "utils/logger.hh"
+#include <list>
+#include <map>
+#include <mutex>
+
+using namespace wt;
+
+
+/** The default capacity of the cache (256MB). */
+#define WT_FILTERBANKCACHE_DEFAULT_CAPACITY (size_t(256) << 20)
+
+/** Holds the items of the cache in the order of their last use (most recent first). */
+struct CacheTable
+{
+  typedef std::pair<std::string, std::shared_ptr<const FilterBankCache::Item> > Entry;
+  typedef std::list<Entry>::iterator Iterator;
+
+  std::list<Entry> items;
+  std::map<std::string, Iterator> index;
+  size_t capacity, memory, hits, misses;
+  std::mutex lock;
+
+  CacheTable()
+    : items(), index(), capacity(WT_FILTERBANKCACHE_DEFAULT_CAPACITY), memory(0), hits(0),
+      misses(0), lock()
+  {
+    // pass...
+  }
+
+  /** Drops the least recently used items until the memory does not exceed @c bytes. */
+  void shrink(size_t bytes) {
+    while ((memory > bytes) && (! items.empty())) {
+      memory -= items.back().second->memory();
+      index.erase(items.back().first);
+      items.pop_back();
+    }
+  }
+
+  static CacheTable &get() {
+    static CacheTable table;
+    return table;
+  }
+};
+
+
+/* ******************************************************************************************** *
+ * Implementation of FilterBankCache
+ * ******************************************************************************************** */
+FilterBankCache::Item::~Item() {
+  // pass...
+}
+
+std::shared_ptr<const FilterBankCache::Item>
+FilterBankCache::find(const std::string &key) {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  std::map<std::string, CacheTable::Iterator>::iterator item = table.index.find(key);
+  if (table.index.end() == item) {
+    table.misses++;
+    return std::shared_ptr<const Item>();
+  }
+  table.hits++;
+  // Move to the front of the list, the iterators remain valid
+  table.items.splice(table.items.begin(), table.items, item->second);
+  return item->second->second;
+}
+
+void
+FilterBankCache::insert(const std::string &key, const std::shared_ptr<const Item> &item) {
+  if (key.empty() || (! item))
+    return;
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  size_t bytes = item->memory();
+  if (bytes > table.capacity)
+    return;
+  // Replace a previous item
+  std::map<std::string, CacheTable::Iterator>::iterator old = table.index.find(key);
+  if (table.index.end() != old) {
+    table.memory -= old->second->second->memory();
+    table.items.erase(old->second);
+    table.index.erase(old);
+  }
+  // Make room for the new item
+  table.shrink(table.capacity-bytes);
+  table.items.push_front(CacheTable::Entry(key, item));
+  table.index[key] = table.items.begin();
+  table.memory += bytes;
+  logDebug() << "Cached filter bank of " << bytes << " bytes (" << table.items.size()
+             << " items, " << table.memory << " bytes total).";
+}
+
+size_t
+FilterBankCache::capacity() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  return table.capacity;
+}
+
+void
+FilterBankCache::setCapacity(size_t bytes) {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  table.capacity = bytes;
+  table.shrink(bytes);
+}
+
+size_t
+FilterBankCache::size() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  return table.items.size();
+}
+
+size_t
+FilterBankCache::memory() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  return table.memory;
+}
+
+size_t
+FilterBankCache::hits() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  return table.hits;
+}
+
+size_t
+FilterBankCache::misses() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  return table.misses;
+}
+
+void
+FilterBankCache::clear() {
+  CacheTable &table = CacheTable::get();
+  std::lock_guard<std::mutex> guard(table.lock);
+  table.shrink(0);
+  table.hits = table.misses = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef __WT_FILTERBANKCACHE_HH__
+#define __WT_FILTERBANKCACHE_HH__
+
+#include <string>
+#include <memory>
+#include <cstddef>
+
+
+namespace wt {
+
+/** A process-wide cache of the filter banks built by the wavelet analyses.
+ *
+ * Building a filter bank evaluates every kernel and performs its FFT. Hence the analyses
+ * (transform, synthesis and projection) look up their filter bank by a key identifying the
+ * analysis, its options, the precision, the wavelet (see @c WaveletObj::identifier) and the
+ * scales before building it. The cached items are shared (read-only) by all analyses using them.
+ *
+ * The cache is bounded by the memory held by the items (see @c capacity). If an insertion
+ * exceeds it, the least recently used items are dropped. Items still in use by some analysis
+ * remain valid until the last analysis using them is destroyed. All methods are thread-safe.
+ * @ingroup analyses */
+class FilterBankCache
+{
+public:
+  /** Base class of all items held by the cache. */
+  class Item
+  {
+  public:
+    /** Destructor. */
+    virtual ~Item();
+    /** Returns the memory held by the item in bytes. */
+    virtual size_t memory() const = 0;
+  };
+
+public:
+  /** Returns the item stored under the @c key or a null pointer if there is none. A found item
+   * becomes the most recently used one. */
+  static std::shared_ptr<const Item> find(const std::string &key);
+  /** Stores the @c item under the @c key (replacing a previous item) and drops the least
+   * recently used items exceeding the capacity. Items larger than the capacity are not stored.
+   * An empty @c key is ignored. */
+  static void insert(const std::string &key, const std::shared_ptr<const Item> &item);
+
+  /** Returns the capacity of the cache in bytes. */
+  static size_t capacity();
+  /** Sets the capacity of the cache in bytes and drops the least recently used items exceeding
+   * it. A capacity of 0 disables the cache. */
+  static void setCapacity(size_t bytes);
+
+  /** Returns the number of items held by the cache. */
+  static size_t size();
+  /** Returns the memory held by the items of the cache in bytes. */
+  static size_t memory();
+  /** Returns the number of successful lookups. */
+  static size_t hits();
+  /** Returns the number of failed lookups. */
+  static size_t misses();
+  /** Drops all items from the cache and resets the statistics. */
+  static void clear();
+};
+
+}
+
+#endif // __WT_FILTERBANKCACHE_HH__
@@ -0,0 +1,89 @@
+#include "mappedmatrix.hh"
+#include "exception.hh"
+#include "utils/logger.hh"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace wt;
+
+
+/* ********************************************************************************************* *
+ * Implementation of MappedFile
+ * ********************************************************************************************* */
+MappedFile::MappedFile(const std::string &filename, size_t rows, size_t cols, size_t elementSize,
+                       const char *descr, Format format)
+  : _fd(-1), _map(0), _size(0), _header(0), _rows(rows), _cols(cols), _elementSize(elementSize)
+{
+  // Assemble NPY header, the data gets aligned to 64 bytes
+  std::string header;
+  if (NPY == format) {
+    std::stringstream dict;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    dict << "{'descr': '>" << descr;
+#else
+    dict << "{'descr': '<" << descr;
+#endif
+    dict << "', 'fortran_order': True, 'shape': (" << rows << ", " << cols << "), }";
+    header = dict.str();
+    size_t len = 10 + header.size() + 1;
+    header.append(64*WT_IDIV_CEIL(len, size_t(64)) - len, ' ');
+    header.push_back('\n');
+    size_t hlen = header.size();
+    header = std::string("\x93NUMPY\x01\x00", 8) + char(hlen & 0xff) + char(hlen >> 8) + header;
+  }
+  _header = header.size();
+  _size = _header + rows*cols*elementSize;
+
+  if (0 > (_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644))) {
+    IOError err; err << "Can not create file '" << filename << "': " << strerror(errno);
+    throw err;
+  }
+  if (0 != ftruncate(_fd, _size)) {
+    IOError err; err << "Can not resize file '" << filename << "' to " << _size << " bytes: "
+                     << strerror(errno);
+    close(_fd);
+    throw err;
+  }
+  if (0 < _size) {
+    _map = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (MAP_FAILED == _map) {
+      IOError err; err << "Can not map file '" << filename << "': " << strerror(errno);
+      close(_fd);
+      throw err;
+    }
+    // The blocks of columns are written front to back and released once complete (see
+    // release()). Advise sequential access, such that the kernel reclaims the pages behind more
+    // aggressively. The advice is only a hint, a failure is ignored.
+    madvise(_map, _size, MADV_SEQUENTIAL);
+    std::memcpy(_map, header.data(), _header);
+  }
+  logDebug() << "Mapped " << rows << "x" << cols << " matrix to file '" << filename << "'.";
+}
+
+MappedFile::~MappedFile() {
+  if (_map)
+    munmap(_map, _size);
+  close(_fd);
+}
+
+void
+MappedFile::release(size_t col, size_t n) {
+  // Only whole pages within the columns are released
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t first = _header + col*_rows*_elementSize, last = _header + (col+n)*_rows*_elementSize;
+  first = page*WT_IDIV_CEIL(first, page); last = page*(last/page);
+  if ((0 == _map) || (last <= first))
+    return;
+  char *ptr = static_cast<char *>(_map) + first;
+  msync(ptr, last-first, MS_ASYNC);
+  madvise(ptr, last-first, MADV_DONTNEED);
+}
+
+void
+MappedFile::sync() {
+  if (_map)
+    msync(_map, _size, MS_SYNC);
+}
@@ -0,0 +1,118 @@
+#ifndef __WT_MAPPEDMATRIX_HH__
+#define __WT_MAPPEDMATRIX_HH__
+
+#include "types.hh"
+#include <string>
+
+
+namespace wt {
+
+/** A file mapped into memory, holding a column-major matrix preceded by an optional header.
+ *
+ * The pages of the file are only backed by the page cache, hence the matrix may be much larger
+ * than the available memory, as long as it is written in large contiguous blocks which are
+ * released (see @c release) once finished.
+ * @ingroup core */
+class MappedFile
+{
+public:
+  /** Possible file formats. */
+  typedef enum {
+    RAW,  ///< Raw, column-major data without header.
+    NPY   ///< NumPy NPY file (version 1.0, Fortran order).
+  } Format;
+
+protected:
+  /** Creates (or truncates) the file @c filename and maps it into memory. The file holds a
+   * @c rows x @c cols matrix of elements of size @c elementSize. For the @c NPY format, the
+   * header is written first, where @c descr specifies the NumPy type of the elements. Throws an
+   * @c IOError if the file can not be created or mapped. */
+  MappedFile(const std::string &filename, size_t rows, size_t cols, size_t elementSize,
+             const char *descr, Format format);
+
+public:
+  /** Destructor, writes back and unmaps the file. */
+  virtual ~MappedFile();
+
+  /** Returns the number of rows. */
+  inline size_t rows() const { return _rows; }
+  /** Returns the number of columns. */
+  inline size_t cols() const { return _cols; }
+  /** Returns the size of the header in bytes. */
+  inline size_t headerSize() const { return _header; }
+
+  /** Starts the write-back of the finished columns [col, col+n) and releases the pages holding
+   * them from the address space. The data remains valid and gets reloaded from the file on
+   * access. */
+  void release(size_t col, size_t n);
+  /** Writes back all data and waits for completion. */
+  void sync();
+
+protected:
+  /** Returns a pointer to the first element of the matrix. */
+  inline void *data() { return static_cast<char *>(_map)+_header; }
+
+protected:
+  /** The file descriptor. */
+  int _fd;
+  /** The mapped file. */
+  void *_map;
+  /** The total size of the file in bytes. */
+  size_t _size;
+  /** The size of the header in bytes. */
+  size_t _header;
+  /** The number of rows and columns. */
+  size_t _rows, _cols;
+  /** The size of the elements in bytes. */
+  size_t _elementSize;
+
+private:
+  // A mapping can not be copied.
+  MappedFile(const MappedFile &other);
+  MappedFile &operator=(const MappedFile &other);
+};
+
+
+/** A complex matrix stored in a memory mapped file, e.g. the output of a
+ * @c GenericWaveletTransform exceeding the available memory.
+ * @ingroup core */
+template <class Scalar>
+class GenericMappedMatrix: public MappedFile
+{
+public:
+  /// Complex valued matrix type.
+  typedef typename Traits<Scalar>::CMatrix CMatrix;
+  /// The matrix mapped to the file.
+  typedef Eigen::Map<CMatrix> Matrix;
+
+public:
+  /** Creates the file @c filename holding a complex @c rows x @c cols matrix. */
+  GenericMappedMatrix(const std::string &filename, size_t rows, size_t cols, Format format=NPY);
+
+  /** Returns the matrix. */
+  inline Matrix &matrix() { return _matrix; }
+
+protected:
+  /** The matrix mapped to the file. */
+  Matrix _matrix;
+};
+
+typedef GenericMappedMatrix<double> MappedMatrix;
+
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericMappedMatrix
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericMappedMatrix<Scalar>::GenericMappedMatrix(const std::string &filename, size_t rows,
+                                                     size_t cols, Format format)
+  : MappedFile(filename, rows, cols, sizeof(typename Traits<Scalar>::Complex),
+               (sizeof(Scalar) == sizeof(double)) ? "c16" : "c8", format),
+    _matrix(static_cast<typename Traits<Scalar>::Complex *>(data()), rows, cols)
+{
+  // pass...
+}
+
+#endif // __WT_MAPPEDMATRIX_HH__
@@ -0,0 +1,268 @@
+#include "simd.hh"
+#include "utils/logger.hh"
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WT_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace wt;
+
+namespace {
+
+/** Number of complex samples of the spectrum processed for all kernels at once (16kB for double
+ * precision, i.e. half of a typical L1 cache). */
+const size_t CHUNK = 1024;
+
+/* ******************************************************************************************** *
+ * Portable kernels
+ * ******************************************************************************************** */
+/** Computes c = a*b or, if @c ADD is @c true, c += a*b element-wise. */
+template <bool ADD, class Scalar>
+inline void
+multiply_generic(const std::complex<Scalar> *a, const std::complex<Scalar> *b,
+                 std::complex<Scalar> *c, size_t n)
+{
+  // Explicit formula, avoids the NaN/Inf checks of std::complex multiplication
+  for (size_t i=0; i<n; i++) {
+    Scalar ar = a[i].real(), ai = a[i].imag(), br = b[i].real(), bi = b[i].imag();
+    std::complex<Scalar> p(ar*br - ai*bi, ar*bi + ai*br);
+    c[i] = ADD ? (c[i] + p) : p;
+  }
+}
+
+template <bool ADD, class Scalar>
+void
+spectrum_generic(const std::complex<Scalar> *part, const std::complex<Scalar> *kernels, size_t ldk,
+                 std::complex<Scalar> *work, size_t ldw, size_t n, size_t K)
+{
+  for (size_t i=0; i<n; i+=CHUNK) {
+    size_t m = std::min(CHUNK, n-i);
+    for (size_t j=0; j<K; j++) {
+      multiply_generic<ADD>(part+i, kernels+j*ldk+i, work+j*ldw+i, m);
+    }
+  }
+}
+
+
+#ifdef WT_SIMD_X86
+/* ******************************************************************************************** *
+ * AVX2 + FMA kernels
+ * ******************************************************************************************** */
+template <bool ADD>
+__attribute__((target("avx2,fma")))
+void
+multiply_avx2(const std::complex<double> *a, const std::complex<double> *b,
+              std::complex<double> *c, size_t n)
+{
+  const double *pa = reinterpret_cast<const double *>(a);
+  const double *pb = reinterpret_cast<const double *>(b);
+  double *pc = reinterpret_cast<double *>(c);
+  size_t i=0;
+  // 2 complex values per register: c = a*re(b) -/+ swap(a)*im(b)
+  for (; (i+2)<=n; i+=2) {
+    __m256d va = _mm256_loadu_pd(pa+2*i), vb = _mm256_loadu_pd(pb+2*i);
+    __m256d bre = _mm256_movedup_pd(vb), bim = _mm256_permute_pd(vb, 0xF);
+    __m256d sa = _mm256_permute_pd(va, 0x5);
+    __m256d vc = _mm256_fmaddsub_pd(va, bre, _mm256_mul_pd(sa, bim));
+    if (ADD)
+      vc = _mm256_add_pd(vc, _mm256_loadu_pd(pc+2*i));
+    _mm256_storeu_pd(pc+2*i, vc);
+  }
+  multiply_generic<ADD>(a+i, b+i, c+i, n-i);
+}
+
+template <bool ADD>
+__attribute__((target("avx2,fma")))
+void
+multiply_avx2(const std::complex<float> *a, const std::complex<float> *b,
+              std::complex<float> *c, size_t n)
+{
+  const float *pa = reinterpret_cast<const float *>(a);
+  const float *pb = reinterpret_cast<const float *>(b);
+  float *pc = reinterpret_cast<float *>(c);
+  size_t i=0;
+  // 4 complex values per register
+  for (; (i+4)<=n; i+=4) {
+    __m256 va = _mm256_loadu_ps(pa+2*i), vb = _mm256_loadu_ps(pb+2*i);
+    __m256 bre = _mm256_moveldup_ps(vb), bim = _mm256_movehdup_ps(vb);
+    __m256 sa = _mm256_permute_ps(va, 0xB1);
+    __m256 vc = _mm256_fmaddsub_ps(va, bre, _mm256_mul_ps(sa, bim));
+    if (ADD)
+      vc = _mm256_add_ps(vc, _mm256_loadu_ps(pc+2*i));
+    _mm256_storeu_ps(pc+2*i, vc);
+  }
+  multiply_generic<ADD>(a+i, b+i, c+i, n-i);
+}
+
+template <bool ADD, class Scalar>
+__attribute__((target("avx2,fma")))
+void
+spectrum_avx2(const std::complex<Scalar> *part, const std::complex<Scalar> *kernels, size_t ldk,
+              std::complex<Scalar> *work, size_t ldw, size_t n, size_t K)
+{
+  for (size_t i=0; i<n; i+=CHUNK) {
+    size_t m = std::min(CHUNK, n-i);
+    for (size_t j=0; j<K; j++) {
+      multiply_avx2<ADD>(part+i, kernels+j*ldk+i, work+j*ldw+i, m);
+    }
+  }
+}
+
+
+/* ******************************************************************************************** *
+ * AVX-512 kernels
+ * ******************************************************************************************** */
+template <bool ADD>
+__attribute__((target("avx512f")))
+void
+multiply_avx512(const std::complex<double> *a, const std::complex<double> *b,
+                std::complex<double> *c, size_t n)
+{
+  const double *pa = reinterpret_cast<const double *>(a);
+  const double *pb = reinterpret_cast<const double *>(b);
+  double *pc = reinterpret_cast<double *>(c);
+  size_t i=0;
+  // 4 complex values per register. The masked permutations (with all lanes selected) pass
+  // the source register instead of an undefined one for the unselected lanes.
+  for (; (i+4)<=n; i+=4) {
+    __m512d va = _mm512_loadu_pd(pa+2*i), vb = _mm512_loadu_pd(pb+2*i);
+    __m512d bre = _mm512_mask_movedup_pd(vb, 0xFF, vb);
+    __m512d bim = _mm512_mask_permute_pd(vb, 0xFF, vb, 0xFF);
+    __m512d sa = _mm512_mask_permute_pd(va, 0xFF, va, 0x55);
+    __m512d vc = _mm512_fmaddsub_pd(va, bre, _mm512_mul_pd(sa, bim));
+    if (ADD)
+      vc = _mm512_add_pd(vc, _mm512_loadu_pd(pc+2*i));
+    _mm512_storeu_pd(pc+2*i, vc);
+  }
+  multiply_generic<ADD>(a+i, b+i, c+i, n-i);
+}
+
+template <bool ADD>
+__attribute__((target("avx512f")))
+void
+multiply_avx512(const std::complex<float> *a, const std::complex<float> *b,
+                std::complex<float> *c, size_t n)
+{
+  const float *pa = reinterpret_cast<const float *>(a);
+  const float *pb = reinterpret_cast<const float *>(b);
+  float *pc = reinterpret_cast<float *>(c);
+  size_t i=0;
+  // 8 complex values per register, masked permutations as above
+  for (; (i+8)<=n; i+=8) {
+    __m512 va = _mm512_loadu_ps(pa+2*i), vb = _mm512_loadu_ps(pb+2*i);
+    __m512 bre = _mm512_mask_moveldup_ps(vb, 0xFFFF, vb);
+    __m512 bim = _mm512_mask_movehdup_ps(vb, 0xFFFF, vb);
+    __m512 sa = _mm512_mask_permute_ps(va, 0xFFFF, va, 0xB1);
+    __m512 vc = _mm512_fmaddsub_ps(va, bre, _mm512_mul_ps(sa, bim));
+    if (ADD)
+      vc = _mm512_add_ps(vc, _mm512_loadu_ps(pc+2*i));
+    _mm512_storeu_ps(pc+2*i, vc);
+  }
+  multiply_generic<ADD>(a+i, b+i, c+i, n-i);
+}
+
+template <bool ADD, class Scalar>
+__attribute__((target("avx512f")))
+void
+spectrum_avx512(const std::complex<Scalar> *part, const std::complex<Scalar> *kernels, size_t ldk,
+                std::complex<Scalar> *work, size_t ldw, size_t n, size_t K)
+{
+  for (size_t i=0; i<n; i+=CHUNK) {
+    size_t m = std::min(CHUNK, n-i);
+    for (size_t j=0; j<K; j++) {
+      multiply_avx512<ADD>(part+i, kernels+j*ldk+i, work+j*ldw+i, m);
+    }
+  }
+}
+#endif // WT_SIMD_X86
+
+
+/** Detects the best supported instruction set. */
+SIMDLevel
+detect() {
+  SIMDLevel level = SIMD_GENERIC;
+#ifdef WT_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    level = SIMD_AVX2;
+  if (__builtin_cpu_supports("avx512f"))
+    level = SIMD_AVX512;
+#endif
+  logDebug() << "Use SIMD level " << int(level) << " for spectrum multiplication.";
+  return level;
+}
+
+/** The currently selected instruction set. */
+std::atomic<int> &
+currentLevel() {
+  static std::atomic<int> level(static_cast<int>(wt::supportedSIMDLevel()));
+  return level;
+}
+
+template <bool ADD, class Scalar>
+inline void
+dispatch(const std::complex<Scalar> *part, const std::complex<Scalar> *kernels, size_t ldk,
+         std::complex<Scalar> *work, size_t ldw, size_t n, size_t K)
+{
+  switch (SIMDLevel(currentLevel().load(std::memory_order_relaxed))) {
+#ifdef WT_SIMD_X86
+  case SIMD_AVX512: spectrum_avx512<ADD>(part, kernels, ldk, work, ldw, n, K); return;
+  case SIMD_AVX2: spectrum_avx2<ADD>(part, kernels, ldk, work, ldw, n, K); return;
+#endif
+  default: spectrum_generic<ADD>(part, kernels, ldk, work, ldw, n, K); return;
+  }
+}
+
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of the public interface
+ * ******************************************************************************************** */
+SIMDLevel
+wt::supportedSIMDLevel() {
+  static SIMDLevel level = detect();
+  return level;
+}
+
+SIMDLevel
+wt::simdLevel() {
+  return SIMDLevel(currentLevel().load());
+}
+
+SIMDLevel
+wt::setSIMDLevel(SIMDLevel level) {
+  level = std::min(level, supportedSIMDLevel());
+  currentLevel().store(int(level));
+  return level;
+}
+
+void
+wt::spectrumMultiply(const std::complex<double> *part, const std::complex<double> *kernels,
+                     size_t ldk, std::complex<double> *work, size_t ldw, size_t n, size_t K)
+{
+  dispatch<false>(part, kernels, ldk, work, ldw, n, K);
+}
+
+void
+wt::spectrumMultiply(const std::complex<float> *part, const std::complex<float> *kernels,
+                     size_t ldk, std::complex<float> *work, size_t ldw, size_t n, size_t K)
+{
+  dispatch<false>(part, kernels, ldk, work, ldw, n, K);
+}
+
+void
+wt::spectrumMultiplyAdd(const std::complex<double> *part, const std::complex<double> *kernels,
+                        size_t ldk, std::complex<double> *work, size_t ldw, size_t n, size_t K)
+{
+  dispatch<true>(part, kernels, ldk, work, ldw, n, K);
+}
+
+void
+wt::spectrumMultiplyAdd(const std::complex<float> *part, const std::complex<float> *kernels,
+                        size_t ldk, std::complex<float> *work, size_t ldw, size_t n, size_t K)
+{
+  dispatch<true>(part, kernels, ldk, work, ldw, n, K);
+}
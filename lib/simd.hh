@@ -0,0 +1,47 @@
+#ifndef __WT_SIMD_HH__
+#define __WT_SIMD_HH__
+
+#include <complex>
+#include <cstddef>
+
+namespace wt {
+
+/** The instruction sets for which hand-vectorized kernels are implemented. */
+typedef enum {
+  SIMD_GENERIC = 0, ///< Portable implementation.
+  SIMD_AVX2    = 1, ///< AVX2 + FMA (x86).
+  SIMD_AVX512  = 2  ///< AVX-512F (x86).
+} SIMDLevel;
+
+/** Returns the best instruction set supported by the CPU. */
+SIMDLevel supportedSIMDLevel();
+/** Returns the instruction set currently used by the kernels. By default, this is the best
+ * supported one. */
+SIMDLevel simdLevel();
+/** Selects the instruction set used by the kernels (e.g., for testing or benchmarking). The level
+ * is limited to the one supported by the CPU. Returns the actually selected level. */
+SIMDLevel setSIMDLevel(SIMDLevel level);
+
+/** Multiplies the first @c n elements of the spectrum @c part with the @c K kernel spectra stored
+ * in the columns of @c kernels (leading dimension @c ldk) and stores the results into the columns
+ * of @c work (leading dimension @c ldw), i.e. \f$w_{ij} = p_i\,k_{ij}\f$. The rows are processed
+ * in chunks, such that a chunk of @c part stays in the L1 cache while it gets multiplied with all
+ * kernels. The @c work matrix may be identical to @c kernels (in-place multiplication). */
+void spectrumMultiply(const std::complex<double> *part, const std::complex<double> *kernels,
+                      size_t ldk, std::complex<double> *work, size_t ldw, size_t n, size_t K);
+/** Single precision variant of the spectrum multiplication. */
+void spectrumMultiply(const std::complex<float> *part, const std::complex<float> *kernels,
+                      size_t ldk, std::complex<float> *work, size_t ldw, size_t n, size_t K);
+
+/** Like @c spectrumMultiply, but accumulates the products into @c work, i.e.
+ * \f$w_{ij} \mathrel{+}= p_i\,k_{ij}\f$. This allows to sum the filtered spectra of several
+ * signals before a single backward transform. */
+void spectrumMultiplyAdd(const std::complex<double> *part, const std::complex<double> *kernels,
+                         size_t ldk, std::complex<double> *work, size_t ldw, size_t n, size_t K);
+/** Single precision variant of the accumulating spectrum multiplication. */
+void spectrumMultiplyAdd(const std::complex<float> *part, const std::complex<float> *kernels,
+                         size_t ldk, std::complex<float> *work, size_t ldw, size_t n, size_t K);
+
+}
+
+#endif // __WT_SIMD_HH__
@@ -0,0 +1,31 @@
+#include "spectralwavelettransform.hh"
+#include <algorithm>
+
+using namespace wt;
+
+
+double
+wt::blockTransformCost(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                       size_t N)
+{
+  // Group scales by kernel size like the GenericWaveletTransform does
+  double cost = 0;
+  size_t M0 = 0, M = 0, K = 0;
+  Eigen::VectorXd sorted(scales); std::sort(sorted.data(), sorted.data()+sorted.size());
+  for (int j=0; j<=sorted.size(); j++) {
+    size_t kernelSize = 0;
+    if (j < sorted.size())
+      kernelSize = FFT<double>::roundUp(std::ceil(sorted(j)*2*wavelet.cutOffTime()));
+    if ((j < sorted.size()) && K && ConvolutionStrategy::merge(M0, M, K, kernelSize)) {
+      M = kernelSize; K++; continue;
+    }
+    // Costs of the previous group. Like the transform, the strategy is selected without
+    // knowing the signal length.
+    if (K) {
+      ConvolutionStrategy strategy(M, K);
+      cost += ConvolutionStrategy::cost(M, K, N, strategy.fftSize(), strategy.algorithm());
+    }
+    M0 = M = kernelSize; K = 1;
+  }
+  return cost;
+}
@@ -0,0 +1,304 @@
+#ifndef __WT_SPECTRALWAVELETTRANSFORM_HH__
+#define __WT_SPECTRALWAVELETTRANSFORM_HH__
+
+#include "waveletanalysis.hh"
+#include "convolution.hh"
+#include "filterbankcache.hh"
+#include <type_traits>
+#include <memory>
+#include <sstream>
+#include <cmath>
+
+
+namespace wt {
+
+/** Implements the continious wavelet transform by a single FFT of the complete signal.
+ *
+ * The signal is zero-padded (by the width of the widest wavelet) and transformed once. For every
+ * scale, the spectrum is multiplied with the sampled spectrum of the scaled wavelet and the
+ * results are transformed back by batched inverse FFTs over several scales. Assuming a signal of
+ * N samples and K scales, the costs are approx. \f$(K+1)\,P\,\log(P)\f$ with \f$P\geq N\f$. Hence
+ * for moderate signal lengths, this transform is usually faster than the block convolution of
+ * the @c GenericWaveletTransform. See @c preferSpectralTransform for a simple heuristic to
+ * choose between both.
+ *
+ * If the wavelet provides its Fourier transform, the spectra of the scaled wavelets are
+ * sampled directly. Otherwise the wavelets are evaluated in the time domain and transformed.
+ * The spectra for an FFT size are held by the @c FilterBankCache, hence subsequent transforms of
+ * signals of the same length reuse them. If they exceed the capacity of the cache, they are
+ * sampled batch by batch instead. Real valued signals are transformed using a real-to-complex
+ * FFT. The FFT plans are obtained from the @c FFTPlanRegistry.
+ * @ingroup analyses */
+template <class Scalar>
+class GenericSpectralWaveletTransform: public WaveletAnalysis
+{
+public:
+  /// Complex scalar type.
+  typedef typename Traits<Scalar>::Complex Complex;
+  /// Real valued vector type.
+  typedef typename Traits<Scalar>::RVector RVector;
+  /// Complex valued vector type.
+  typedef typename Traits<Scalar>::CVector CVector;
+  /// Complex valued matrix type.
+  typedef typename Traits<Scalar>::CMatrix CMatrix;
+
+public:
+  /** Constructs a wavelet transform from the given @c wavelet at the specified @c scales. The
+   * inverse FFTs are performed in batches of @c batchSize scales. */
+  GenericSpectralWaveletTransform(const Wavelet &wavelet,
+                                  const Eigen::Ref<const Eigen::VectorXd> &scales,
+                                  size_t batchSize=16);
+  /** Constructs a wavelet transform from the given @c wavelet at the specified @c scales. */
+  GenericSpectralWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales,
+                                  size_t batchSize=16);
+  /** Constructor from other wavelet analysis. */
+  GenericSpectralWaveletTransform(const WaveletAnalysis &other, size_t batchSize=16);
+
+  /** Destructor. */
+  virtual ~GenericSpectralWaveletTransform();
+
+  /** Performs the wavelet transform on the given @c signal and stores the result into the given
+   * @c out matrix. The wavelet transformed for the j-th scale is stored in the j-th column
+   * of the matrix, hence the matrix must have N rows and K colmums where K is the number of scales
+   * and N is the number of samples in signal. A transform can be applied concurrently from
+   * several threads. */
+  template <class iDerived, class oDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                   ProgressDelegateInterface *progress=0) const;
+
+  /** Returns the FFT size used to transform a signal of @c N samples. */
+  size_t fftSize(size_t N) const;
+
+  /** Returns the estimated costs of the transform of a signal with @c N samples at the given
+   * @c scales. The costs are comparable to @c ConvolutionStrategy::cost. */
+  static double cost(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                     size_t N);
+
+protected:
+  /** Holds the spectra of the wavelets at all scales for an FFT size in the
+   * @c FilterBankCache. */
+  class KernelSpectra: public FilterBankCache::Item
+  {
+  public:
+    /** Returns the memory held by the spectra in bytes. */
+    virtual size_t memory() const { return spectra.size()*sizeof(Complex); }
+
+  public:
+    /** The spectra, one column for each scale. */
+    CMatrix spectra;
+  };
+
+protected:
+  /** Computes the spectrum of the signal. */
+  template <class iDerived>
+  void _forward(const Eigen::DenseBase<iDerived> &signal, CVector &spectrum,
+                std::true_type) const;
+  /** Computes the spectrum of a real signal using the real-to-complex FFT. */
+  template <class iDerived>
+  void _forward(const Eigen::DenseBase<iDerived> &signal, CVector &spectrum,
+                std::false_type) const;
+  /** Stores the spectra of the wavelets at the scales [j, j+work.cols()) into the columns of
+   * @c work. The normalization of the backward FFT is folded into the spectra. */
+  void _kernels(size_t j, CMatrix &work) const;
+  /** Returns the spectra of the wavelets at all scales for the FFT size @c P from the
+   * @c FilterBankCache. Returns a null pointer if they can not be cached. */
+  std::shared_ptr<const KernelSpectra> _kernelSpectra(size_t P) const;
+
+protected:
+  /** The number of scales transformed back at once. */
+  size_t _batchSize;
+};
+
+typedef GenericSpectralWaveletTransform<double> SpectralWaveletTransform;
+
+
+/** Estimates the costs of the block convolution wavelet transform (w/o sub-sampling) of a
+ * signal of @c N samples at the given @c scales. */
+double blockTransformCost(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                          size_t N);
+
+/** Returns @c true if the @c SpectralWaveletTransform is expected to be faster than the block
+ * convolution @c WaveletTransform for a signal of @c N samples at the given @c scales. */
+inline bool
+preferSpectralTransform(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                        size_t N) {
+  return SpectralWaveletTransform::cost(wavelet, scales, N) < blockTransformCost(wavelet, scales, N);
+}
+
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericSpectralWaveletTransform
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericSpectralWaveletTransform<Scalar>::GenericSpectralWaveletTransform(
+    const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales, size_t batchSize)
+  : WaveletAnalysis(wavelet, scales), _batchSize(std::max(batchSize, size_t(1)))
+{
+  // pass...
+}
+
+template <class Scalar>
+wt::GenericSpectralWaveletTransform<Scalar>::GenericSpectralWaveletTransform(
+    const Wavelet &wavelet, double *scales, int Nscales, size_t batchSize)
+  : WaveletAnalysis(wavelet, scales, Nscales), _batchSize(std::max(batchSize, size_t(1)))
+{
+  // pass...
+}
+
+template <class Scalar>
+wt::GenericSpectralWaveletTransform<Scalar>::GenericSpectralWaveletTransform(
+    const WaveletAnalysis &other, size_t batchSize)
+  : WaveletAnalysis(other), _batchSize(std::max(batchSize, size_t(1)))
+{
+  // pass...
+}
+
+template <class Scalar>
+wt::GenericSpectralWaveletTransform<Scalar>::~GenericSpectralWaveletTransform() {
+  // pass...
+}
+
+template <class Scalar>
+size_t
+wt::GenericSpectralWaveletTransform<Scalar>::fftSize(size_t N) const {
+  // Zero-pad by the width of the widest wavelet to avoid the wrap-around of the circular
+  // convolution
+  double maxScale = (0 == _scales.size()) ? 0 : _scales.maxCoeff();
+  return FFT<Scalar>::roundUp(N + 2*size_t(std::ceil(maxScale*_wavelet.cutOffTime())));
+}
+
+template <class Scalar>
+double
+wt::GenericSpectralWaveletTransform<Scalar>::cost(
+    const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales, size_t N)
+{
+  double maxScale = (0 == scales.size()) ? 0 : scales.maxCoeff();
+  double P = FFT<Scalar>::roundUp(N + 2*size_t(std::ceil(maxScale*wavelet.cutOffTime())));
+  size_t K = scales.size();
+  // One forward and K backward FFTs, multiplication with the (cached) K spectra and storage
+  return (K+1)*P*std::log2(P) + K*P + K*N;
+}
+
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericSpectralWaveletTransform<Scalar>::_forward(
+    const Eigen::DenseBase<iDerived> &signal, CVector &spectrum, std::true_type) const
+{
+  size_t N = signal.size(), P = spectrum.size();
+  spectrum.head(N) = signal.template cast<Complex>();
+  spectrum.tail(P-N).setConstant(0);
+  FFT<Scalar>(spectrum, FFT<Scalar>::FORWARD).exec();
+}
+
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericSpectralWaveletTransform<Scalar>::_forward(
+    const Eigen::DenseBase<iDerived> &signal, CVector &spectrum, std::false_type) const
+{
+  size_t N = signal.size(), P = spectrum.size();
+  RVector rsignal(P);
+  rsignal.head(N) = signal.template cast<Scalar>();
+  rsignal.tail(P-N).setConstant(0);
+  // Transform the first P/2+1 frequencies, the remaining ones follow from the symmetry
+  FFT<Scalar>(rsignal, spectrum).exec();
+  size_t nneg = (P-1)/2;
+  spectrum.tail(nneg) = spectrum.segment(1, nneg).reverse().conjugate();
+}
+
+template <class Scalar>
+void
+wt::GenericSpectralWaveletTransform<Scalar>::_kernels(size_t j, CMatrix &work) const
+{
+  size_t P = work.rows(), K = work.cols();
+  if (_wavelet.hasSpectrum()) {
+    // Sample spectra of the wavelets directly
+    for (size_t k=0; k<K; k++) {
+      for (size_t i=0; i<P; i++) {
+        double f = ((2*i <= P) ? double(i) : (double(i)-double(P)))/P;
+        work(i,k) = Complex( sampledSpectrum(f, _scales(j+k), 0) / double(P) );
+      }
+    }
+    return;
+  }
+  // Otherwise evaluate the (centered) wavelets in the time domain and transform them
+  work.setConstant(0);
+  for (size_t k=0; k<K; k++) {
+    double scale = _scales(j+k);
+    int W = std::min(int(std::ceil(scale*_wavelet.cutOffTime())), int(P-1)/2);
+    for (int m=-W; m<=W; m++) {
+      work((m+int(P))%int(P), k) = Complex( _wavelet.evalAnalysis(m/scale)/scale/double(P) );
+    }
+  }
+  FFT<Scalar>(work, FFT<Scalar>::FORWARD).exec();
+}
+
+template <class Scalar>
+std::shared_ptr<const typename wt::GenericSpectralWaveletTransform<Scalar>::KernelSpectra>
+wt::GenericSpectralWaveletTransform<Scalar>::_kernelSpectra(size_t P) const
+{
+  std::ostringstream kind;
+  kind << "spectral;" << sizeof(Scalar) << ";" << P;
+  std::string key = this->cacheKey(kind.str());
+  if (key.empty() || (P*_scales.size()*sizeof(Complex) > FilterBankCache::capacity()))
+    return std::shared_ptr<const KernelSpectra>();
+  std::shared_ptr<const KernelSpectra> kernels =
+      std::dynamic_pointer_cast<const KernelSpectra>(FilterBankCache::find(key));
+  if (kernels)
+    return kernels;
+  std::shared_ptr<KernelSpectra> spectra(new KernelSpectra());
+  spectra->spectra.resize(P, _scales.size());
+  this->_kernels(0, spectra->spectra);
+  FilterBankCache::insert(key, spectra);
+  return spectra;
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericSpectralWaveletTransform<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    ProgressDelegateInterface *progress) const
+{
+  // Selects the complex or real forward transform of the signal
+  typedef std::integral_constant<
+      bool, Eigen::NumTraits<typename iDerived::Scalar>::IsComplex> IsComplex;
+
+  size_t N = signal.size(), K = _scales.size();
+  size_t P = this->fftSize(N);
+
+  // Forward transform of the zero-padded signal
+  CVector spectrum(P);
+  this->_forward(signal, spectrum, IsComplex());
+
+  // Spectra of the scaled wavelets (if they can be held at once)
+  std::shared_ptr<const KernelSpectra> kernels = this->_kernelSpectra(P);
+
+  // Perform the inverse transforms in batches of scales
+  CMatrix work;
+  std::unique_ptr< FFT<Scalar> > backward;
+  for (size_t j=0; j<K; j+=_batchSize) {
+    size_t B = std::min(_batchSize, K-j);
+    if (size_t(work.cols()) != B) {
+      work.resize(P, B);
+      backward.reset(new FFT<Scalar>(work, FFT<Scalar>::BACKWARD));
+    }
+    // Multiply the spectra of the scaled wavelets with the spectrum of the signal
+    if (kernels) {
+      spectrumMultiply(spectrum.data(), kernels->spectra.col(j).data(), P, work.data(), P, P, B);
+    } else {
+      this->_kernels(j, work);
+      spectrumMultiply(spectrum.data(), work.data(), P, work.data(), P, P, B);
+    }
+    // Batched backward transform
+    backward->exec();
+    out.block(0, j, N, B) = work.topRows(N).template cast<typename oDerived::Scalar>();
+    if (progress)
+      (*progress)(double(j+B)/K);
+  }
+}
+
+#endif // __WT_SPECTRALWAVELETTRANSFORM_HH__
@@ -0,0 +1,443 @@
+#ifndef __WT_STREAMINGWAVELETTRANSFORM_HH__
+#define __WT_STREAMINGWAVELETTRANSFORM_HH__
+
+#include "wavelettransform.hh"
+#include <limits>
+
+
+namespace wt {
+
+/** Implements an online (streaming) wavelet transform.
+ *
+ * The signal is passed in chunks of arbitrary size to @c push. Each call returns all rows of the
+ * transform which are complete, i.e. which do not depend on future samples anymore. Hence the
+ * delay between input and output is given by the half-width of the largest (sub-sampled) wavelet
+ * and does not depend on the chunk size. In the causal mode (see @c GenericWaveletTransform),
+ * the rows are finished as soon as the corresponding samples are pushed (sub-sampled scales up to
+ * two sub-sampling intervals later). At the end of the stream, @c flush returns the remaining
+ * rows. The concatenated output equals the output of the @c GenericWaveletTransform applied to the
+ * complete signal, up to rounding errors (the input is split into different blocks).
+ *
+ * Each group of the filter bank keeps its own state, i.e. the pending (sub-sampled) input
+ * samples, a convolution workspace holding the overlap-add tails (see
+ * @c GenericConvolution::applyStream) and a ring buffer of finished rows. Hence the memory
+ * required is bounded and independent of the length of the stream.
+ *
+ * Complete blocks are filtered as soon as they are pushed. The incomplete block of a group is only
+ * filtered by @c push if this yields rows finished by all groups, i.e. rows that can be returned,
+ * and if it holds at least @c minBlockLength() input samples. Pushing a few samples at a time
+ * still filters the incomplete block of the slowest group on every call. Hence, a larger minimum
+ * block length (see @c setMinBlockLength) reduces the costs at the expense of an additional delay
+ * of up to that many samples.
+ * @ingroup analyses */
+template <class Scalar>
+class GenericStreamingWaveletTransform: public GenericWaveletTransform<Scalar>
+{
+public:
+  /// Complex scalar type.
+  typedef typename Traits<Scalar>::Complex Complex;
+  /// Complex valued vector type.
+  typedef typename Traits<Scalar>::CVector CVector;
+  /// Complex valued matrix type.
+  typedef typename Traits<Scalar>::CMatrix CMatrix;
+
+protected:
+  /** The streaming state of a single group of the filter bank. */
+  class GroupStream
+  {
+  public:
+    /** Constructs the state for the group @c conv. If @c causal is @c true, the first half of
+     * the kernels vanishes and the samples are finished without delay. */
+    GroupStream(const GenericConvolution<Scalar> &conv, bool causal);
+
+    /** Resets the state for a new stream. */
+    void reset();
+    /** Appends the input sample @c x, filters every complete block. */
+    inline void push(const Complex &x);
+    /** Returns @c true if pushing @c n further input samples completes a block. */
+    inline bool fills(size_t n) const { return (_npending*_S+_nsum+n) >= _L*_S; }
+    /** Returns the number of input samples pending in the incomplete block. */
+    inline size_t pending() const { return _npending*_S; }
+    /** Returns the number of rows stored so far. If @c processed is @c true, the rows stored
+     * after the pending input got filtered are returned. */
+    inline size_t rows(bool processed) const {
+      return this->_rowsUntil(processed ? (_pos+ptrdiff_t(_npending+_ahead)) : _next);
+    }
+    /** Filters the pending input, if any. */
+    void process();
+    /** Finishes the stream of @c N input samples. */
+    void finish(size_t N);
+
+    /** Returns the number of finished rows. */
+    inline size_t available() const { return _count; }
+    /** Moves the first @c n finished rows into the block of @c out starting at @c col. */
+    void take(CMatrix &out, size_t col, size_t n);
+
+  protected:
+    /** Returns the number of rows stored once the samples before @c next of the convolution
+     * are stored. */
+    inline size_t _rowsUntil(ptrdiff_t next) const {
+      ptrdiff_t s = next-1-ptrdiff_t(_M/2);
+      if (1 == _S)
+        return std::max(s+1, ptrdiff_t(0));
+      return std::max(s, ptrdiff_t(0))*_S;
+    }
+    /** Stores the sample @c s of the (sub-sampled) convolution, i.e. appends the rows
+     * interpolated between the previous and this sample. */
+    void _emit(ptrdiff_t s, const CVector &value);
+    /** Appends a row to the ring buffer. */
+    inline void _append(const CVector &row);
+
+  protected:
+    /** The convolution filters of the group. */
+    const GenericConvolution<Scalar> &_conv;
+    /** Sub-sampling, kernel length, number of kernels, FFT size and block length. */
+    size_t _S, _M, _K, _P, _L;
+    /** The number of samples of the convolution finished ahead of the input, i.e. the number of
+     * leading zeros of the kernels. */
+    size_t _ahead;
+    /** The sum over the current input samples of a sub-sample. */
+    Complex _sum;
+    /** The number of input samples summed in @c _sum. */
+    size_t _nsum;
+    /** The pending (sub-sampled) input samples. */
+    CVector _pending;
+    /** The number of pending input samples. */
+    size_t _npending;
+    /** The index of the first pending sample. */
+    ptrdiff_t _pos;
+    /** The index of the next sample of the convolution to store. */
+    ptrdiff_t _next;
+    /** The workspace of the convolution, holds the overlap-add tails of the last block. */
+    typename GenericConvolution<Scalar>::Workspace _ws;
+    /** The convolution of the last block, one column per kernel. */
+    CMatrix _block;
+    /** The last sample of the convolution (used for the interpolation). */
+    CVector _prev;
+    /** Scratch row. */
+    CVector _value;
+    /** Ring buffer of finished rows. */
+    CMatrix _rows;
+    /** The first row and number of rows in the ring buffer. */
+    size_t _head, _count;
+  };
+
+public:
+  /** Constructs a streaming wavelet transform from the given @c wavelet at the specified
+   * @c scales. If @c analytic is @c true, the negative frequencies of the wavelets are
+   * neglected. */
+  GenericStreamingWaveletTransform(const Wavelet &wavelet,
+                                   const Eigen::Ref<const Eigen::VectorXd> &scales,
+                                   bool subSample=false, bool analytic=false, bool causal=false);
+  /** Constructs a streaming wavelet transform from the given @c wavelet at the specified
+   * @c scales. */
+  GenericStreamingWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales,
+                                   bool subSample=false, bool analytic=false, bool causal=false);
+  /** Constructor from other wavelet analysis. */
+  GenericStreamingWaveletTransform(const WaveletAnalysis &other, bool subSample=false,
+                                   bool analytic=false, bool causal=false);
+
+  /** Destructor. */
+  virtual ~GenericStreamingWaveletTransform();
+
+  /** Appends the given @c samples to the stream. The rows of the transform finished so far are
+   * stored into @c out, which gets resized to the number of finished rows and one column per
+   * scale. Returns the number of finished rows. */
+  template <class iDerived>
+  size_t push(const Eigen::DenseBase<iDerived> &samples, CMatrix &out);
+  /** Ends the stream and stores the remaining rows into @c out. Returns the number of rows.
+   * Afterwards a new stream can be started. */
+  size_t flush(CMatrix &out);
+  /** Discards the current stream. */
+  void reset();
+
+  /** Returns the number of samples pushed into the current stream. */
+  inline size_t numSamples() const { return _N; }
+  /** Returns the number of rows returned for the current stream. */
+  inline size_t numRows() const { return _rows; }
+
+  /** Returns the minimum number of input samples filtered at once by @c push. */
+  inline size_t minBlockLength() const { return _minBlock; }
+  /** Sets the minimum number of input samples filtered at once by @c push (default 1). The
+   * pending input of a group is kept until it holds at least @c samples samples or completes a
+   * block, hence the output may be delayed by up to that many samples. */
+  inline void setMinBlockLength(size_t samples) { _minBlock = std::max(samples, size_t(1)); }
+
+protected:
+  /** Allocates the state of every group. */
+  void init_stream();
+  /** Moves the rows finished by all groups into @c out. */
+  size_t _collect(CMatrix &out);
+
+protected:
+  /** The streaming state of each group of the filter bank. */
+  std::vector< std::unique_ptr<GroupStream> > _streams;
+  /** The number of samples pushed. */
+  size_t _N;
+  /** The number of rows returned. */
+  size_t _rows;
+  /** The minimum number of input samples filtered at once by @c push. */
+  size_t _minBlock;
+};
+
+typedef GenericStreamingWaveletTransform<double> StreamingWaveletTransform;
+
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericStreamingWaveletTransform::GroupStream
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::GroupStream(
+    const GenericConvolution<Scalar> &conv, bool causal)
+  : _conv(conv), _S(std::max(conv.subSampling(), size_t(1))), _M(conv.kernelLength()),
+    _K(conv.numKernels()), _P(conv.fftSize()), _L(conv.blockLength()),
+    _ahead(causal ? _M/2 : 0), _pending(_L), _ws(conv), _block(_P, _K), _prev(_K), _value(_K),
+    _rows(_S*_L, _K)
+{
+  this->reset();
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::reset() {
+  _sum = 0; _nsum = 0;
+  _npending = 0; _pos = 0; _next = 0;
+  _ws.reset();
+  _prev.setConstant(0);
+  _head = _count = 0;
+}
+
+template <class Scalar>
+inline void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::push(const Complex &x) {
+  _sum += x;
+  if (++_nsum < _S)
+    return;
+  _pending(_npending++) = _sum;
+  _sum = 0; _nsum = 0;
+  if (_L == _npending)
+    this->process();
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::process()
+{
+  size_t l = _npending;
+  ptrdiff_t shift = _M/2;
+  if (0 == l)
+    return;
+  // Filter the block, the workspace keeps the tails y[pos+l...pos+l+M-1)
+  _conv.applyStream(_pending.head(l), _block, _ws);
+  // The samples y[pos...pos+l) are complete, if the kernels start with zeros, the following
+  // samples too
+  ptrdiff_t end = _pos+ptrdiff_t(l+_ahead);
+  for (; _next<end; _next++) {
+    _value = _block.row(_next-_pos).transpose();
+    this->_emit(_next-shift, _value);
+  }
+  _pos += l; _npending = 0;
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::finish(size_t N)
+{
+  // Process incomplete sub-sample and pending input
+  if (0 < _nsum) {
+    _pending(_npending++) = _sum;
+    _sum = 0; _nsum = 0;
+  }
+  this->process();
+  // Store the remaining samples from the tails, i.e. the convolution of an empty block
+  ptrdiff_t shift = _M/2;
+  _conv.applyStream(_pending.head(0), _block, _ws);
+  for (; _next<(_pos+shift); _next++) {
+    _value = _block.row(_next-_pos).transpose();
+    this->_emit(_next-shift, _value);
+  }
+  // Interpolate the rows behind the last sample
+  if ((1 < _S) && (0 < _pos)) {
+    Scalar S = _S;
+    for (size_t r=(_pos-1)*_S; r<N; r++) {
+      Scalar m = r-(_pos-1)*_S;
+      _value = _prev*((S-m)/S);
+      this->_append(_value);
+    }
+  }
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::_emit(ptrdiff_t s, const CVector &value)
+{
+  if (s < 0)
+    return;
+  if (1 == _S) {
+    this->_append(value);
+    return;
+  }
+  // Interpolate the rows between the previous and this sample
+  if (s > 0) {
+    Scalar S = _S;
+    for (size_t m=0; m<_S; m++) {
+      CVector row = (_prev*(S-Scalar(m)) + value*Scalar(m))/S;
+      this->_append(row);
+    }
+  }
+  _prev = value;
+}
+
+template <class Scalar>
+inline void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::_append(const CVector &row)
+{
+  size_t R = _rows.rows();
+  if (R == _count) {
+    // Grow ring buffer, keeping the rows in order
+    CMatrix rows(2*R, _K);
+    for (size_t i=0; i<_count; i++)
+      rows.row(i) = _rows.row((_head+i) % R);
+    _rows.swap(rows);
+    _head = 0; R = _rows.rows();
+  }
+  _rows.row((_head+_count) % R) = row.transpose();
+  _count++;
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::GroupStream::take(CMatrix &out, size_t col, size_t n)
+{
+  size_t R = _rows.rows();
+  // Copy the (up to) two contiguous parts of the ring buffer
+  size_t n1 = std::min(n, R-_head);
+  out.block(0, col, n1, _K) = _rows.middleRows(_head, n1);
+  if (n1 < n)
+    out.block(n1, col, n-n1, _K) = _rows.topRows(n-n1);
+  _head = (_head+n) % R; _count -= n;
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of GenericStreamingWaveletTransform
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericStreamingWaveletTransform<Scalar>::GenericStreamingWaveletTransform(
+    const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales, bool subSample,
+    bool analytic, bool causal)
+  : GenericWaveletTransform<Scalar>(wavelet, scales, subSample, analytic, causal), _streams(),
+    _N(0), _rows(0), _minBlock(1)
+{
+  this->init_stream();
+}
+
+template <class Scalar>
+wt::GenericStreamingWaveletTransform<Scalar>::GenericStreamingWaveletTransform(
+    const Wavelet &wavelet, double *scales, int Nscales, bool subSample, bool analytic,
+    bool causal)
+  : GenericWaveletTransform<Scalar>(wavelet, scales, Nscales, subSample, analytic, causal),
+    _streams(), _N(0), _rows(0), _minBlock(1)
+{
+  this->init_stream();
+}
+
+template <class Scalar>
+wt::GenericStreamingWaveletTransform<Scalar>::GenericStreamingWaveletTransform(
+    const WaveletAnalysis &other, bool subSample, bool analytic, bool causal)
+  : GenericWaveletTransform<Scalar>(other, subSample, analytic, causal), _streams(), _N(0),
+    _rows(0), _minBlock(1)
+{
+  this->init_stream();
+}
+
+template <class Scalar>
+wt::GenericStreamingWaveletTransform<Scalar>::~GenericStreamingWaveletTransform() {
+  // pass...
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::init_stream() {
+  const GenericFilterBank<Scalar> &filterBank = *this->_filterBank;
+  for (size_t j=0; j<filterBank.numGroups(); j++)
+    _streams.push_back(std::unique_ptr<GroupStream>(new GroupStream(filterBank.group(j), this->_causal)));
+}
+
+template <class Scalar>
+void
+wt::GenericStreamingWaveletTransform<Scalar>::reset() {
+  for (size_t j=0; j<_streams.size(); j++)
+    _streams[j]->reset();
+  _N = 0; _rows = 0;
+}
+
+template <class Scalar>
+template <class iDerived>
+size_t
+wt::GenericStreamingWaveletTransform<Scalar>::push(const Eigen::DenseBase<iDerived> &samples,
+                                                   CMatrix &out)
+{
+  size_t n = samples.size(), G = _streams.size();
+  // The groups are independent, a parallel region is only needed if some block gets filtered
+  bool fills = false;
+  for (size_t j=0; (j<G) && (! fills); j++)
+    fills = _streams[j]->fills(n);
+  #pragma omp parallel for schedule(dynamic) if (fills)
+  for (size_t j=0; j<G; j++) {
+    GroupStream &stream = *_streams[j];
+    for (size_t i=0; i<n; i++)
+      stream.push(Complex(samples.derived().coeff(i)));
+  }
+  _N += n;
+
+  // Only rows finished by all groups are returned. Hence the incomplete blocks are only filtered
+  // by the groups lagging behind the rows all groups can finish.
+  std::vector<size_t> process;
+  size_t target = std::numeric_limits<size_t>::max();
+  for (size_t j=0; j<G; j++) {
+    bool ready = (_streams[j]->pending() >= _minBlock);
+    target = std::min(target, _streams[j]->rows(ready));
+  }
+  for (size_t j=0; j<G; j++) {
+    if ((_streams[j]->pending() >= _minBlock) && (_streams[j]->rows(false) < target))
+      process.push_back(j);
+  }
+  #pragma omp parallel for schedule(dynamic) if (1 < process.size())
+  for (size_t i=0; i<process.size(); i++)
+    _streams[process[i]]->process();
+  return this->_collect(out);
+}
+
+template <class Scalar>
+size_t
+wt::GenericStreamingWaveletTransform<Scalar>::flush(CMatrix &out)
+{
+  for (size_t j=0; j<_streams.size(); j++)
+    _streams[j]->finish(_N);
+  size_t n = this->_collect(out);
+  this->reset();
+  return n;
+}
+
+template <class Scalar>
+size_t
+wt::GenericStreamingWaveletTransform<Scalar>::_collect(CMatrix &out)
+{
+  const GenericFilterBank<Scalar> &filterBank = *this->_filterBank;
+  // Only the rows finished by all groups are returned
+  size_t n = std::numeric_limits<size_t>::max();
+  for (size_t j=0; j<_streams.size(); j++)
+    n = std::min(n, _streams[j]->available());
+  if (_streams.empty())
+    n = 0;
+  out.resize(n, filterBank.numKernels());
+  for (size_t j=0; j<_streams.size(); j++)
+    _streams[j]->take(out, filterBank.offset(j), n);
+  _rows += n;
+  return n;
+}
+
+#endif // __WT_STREAMINGWAVELETTRANSFORM_HH__
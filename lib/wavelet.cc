@@ -1,5 +1,7 @@
 #include "wavelet.hh"
 #include <cmath>
+#include <sstream>
+#include <iomanip>
 
 using namespace wt;
 
@@ -22,6 +24,34 @@ WaveletObj::normConstant() const {
   return 1.0;
 }
 
+bool
+WaveletObj::hasSpectrum() const {
+  return false;
+}
+
+std::complex<double>
+WaveletObj::evalAnalysisSpectrum(const double &) const {
+  return 0;
+}
+
+std::complex<double>
+WaveletObj::evalSynthesisSpectrum(const double &) const {
+  return 0;
+}
+
+std::string
+WaveletObj::identifier() const {
+  return "";
+}
+
+/** Formats the identifier of a wavelet with a single parameter, which is stored exactly. */
+static std::string
+formatIdentifier(const char *name, const char *param, double value) {
+  std::ostringstream id;
+  id << name << "(" << param << "=" << std::setprecision(17) << value << ")";
+  return id.str();
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of Morlet wavelet
@@ -61,6 +91,21 @@ MorletObj::evalRepKern(const double &b, const double &a) const {
   return  c * std::exp(std::complex<double>(re, im));
 }
 
+bool
+MorletObj::hasSpectrum() const {
+  return true;
+}
+
+std::complex<double>
+MorletObj::evalAnalysisSpectrum(const double &f) const {
+  return std::exp(-2*M_PI*M_PI*(f-1)*(f-1)/_dff);
+}
+
+std::complex<double>
+MorletObj::evalSynthesisSpectrum(const double &f) const {
+  return this->evalAnalysisSpectrum(f);
+}
+
 double
 MorletObj::cutOffTime() const {
   // 99% power at scale 1
@@ -73,6 +118,11 @@ MorletObj::cutOffFreq() const {
   return 1+3.*std::sqrt(_dff);
 }
 
+std::string
+MorletObj::identifier() const {
+  return formatIdentifier("Morlet", "dff", _dff);
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of RegMorletObj wavelet
@@ -112,6 +162,21 @@ RegMorletObj::evalRepKern(const double &b, const double &a) const {
   return  c * std::exp(std::complex<double>(re, im));
 }
 
+bool
+RegMorletObj::hasSpectrum() const {
+  return true;
+}
+
+std::complex<double>
+RegMorletObj::evalAnalysisSpectrum(const double &f) const {
+  return std::exp(-2*M_PI*M_PI*(f+1)*(f+1)/_dff);
+}
+
+std::complex<double>
+RegMorletObj::evalSynthesisSpectrum(const double &f) const {
+  return this->evalAnalysisSpectrum(f);
+}
+
 double
 RegMorletObj::cutOffTime() const {
   // 99% power at scale 1
@@ -124,6 +189,11 @@ RegMorletObj::cutOffFreq() const {
   return 1+3.*std::sqrt(_dff);
 }
 
+std::string
+RegMorletObj::identifier() const {
+  return formatIdentifier("RegMorlet", "dff", _dff);
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of Couchy wavelet object
@@ -161,6 +231,25 @@ CauchyObj::evalRepKern(const double &b, const double &a) const {
   return std::exp(c) * std::pow(std::complex<double>(1+a, -2*M_PI*b/_alpha), -(1+2*_alpha));
 }
 
+bool
+CauchyObj::hasSpectrum() const {
+  return true;
+}
+
+std::complex<double>
+CauchyObj::evalAnalysisSpectrum(const double &f) const {
+  // Vanishes for negative frequencies (progressive wavelet)
+  if (f <= 0)
+    return 0;
+  return std::exp( (1+_alpha)*std::log(_alpha) + _alpha*std::log(f) - _alpha*f
+                   - std::lgamma(1+_alpha) );
+}
+
+std::complex<double>
+CauchyObj::evalSynthesisSpectrum(const double &f) const {
+  return CauchyObj::evalAnalysisSpectrum(f);
+}
+
 double
 CauchyObj::normConstant() const {
   return _norm;
@@ -179,6 +268,11 @@ CauchyObj::cutOffFreq() const {
   return 1+1./( _alpha*_alpha * ( std::pow(eps, -2. / (_alpha+1)) - 1) / ((2*M_PI)*(2*M_PI)) );
 }
 
+std::string
+CauchyObj::identifier() const {
+  return formatIdentifier("Cauchy", "alpha", _alpha);
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of RegCouchy wavelet object
@@ -216,6 +310,25 @@ RegCauchyObj::evalRepKern(const double &b, const double &a) const {
   return std::exp(c) * std::pow(std::complex<double>(1+a, 2*M_PI*b/_alpha), -(1+2*_alpha));
 }
 
+bool
+RegCauchyObj::hasSpectrum() const {
+  return true;
+}
+
+std::complex<double>
+RegCauchyObj::evalAnalysisSpectrum(const double &f) const {
+  // Vanishes for positive frequencies (regressive wavelet)
+  if (f >= 0)
+    return 0;
+  return std::exp( (1+_alpha)*std::log(_alpha) + _alpha*std::log(-f) + _alpha*f
+                   - std::lgamma(1+_alpha) );
+}
+
+std::complex<double>
+RegCauchyObj::evalSynthesisSpectrum(const double &f) const {
+  return RegCauchyObj::evalAnalysisSpectrum(f);
+}
+
 double
 RegCauchyObj::normConstant() const {
   return _norm;
@@ -233,3 +346,8 @@ RegCauchyObj::cutOffFreq() const {
   double eps = 1e-2;
   return 1+1./( _alpha*_alpha * ( std::pow(eps, -2. / (_alpha+1)) - 1) / ((2*M_PI)*(2*M_PI)) );
 }
+
+std::string
+RegCauchyObj::identifier() const {
+  return formatIdentifier("RegCauchy", "alpha", _alpha);
+}
@@ -2,6 +2,7 @@
 #define __WT_WAVELET_HH__
 
 #include "types.hh"
+#include <string>
 
 namespace wt {
 
@@ -33,6 +34,21 @@ public:
   /** Returns the spectral width of the unscaled wavelet in frequency (frequency resolution).
    * This can be considered as the "width" of the Fourier transformed wavelet. */
   virtual double cutOffFreq() const = 0;
+  /** Returns @c true if the Fourier transforms of the wavelet pair are known in closed form,
+   * i.e. if @c evalAnalysisSpectrum and @c evalSynthesisSpectrum are implemented. */
+  virtual bool hasSpectrum() const;
+  /** Evaluates the Fourier transform \f$\hat{g}(f)=\int g(t)\,e^{-2\pi i f t}\,dt\f$ of the
+   * analysis wavelet at frequency @c f. The default implementation returns 0. */
+  virtual std::complex<double> evalAnalysisSpectrum(const double &f) const;
+  /** Evaluates the Fourier transform of the synthesis wavelet at frequency @c f. The default
+   * implementation returns 0. */
+  virtual std::complex<double> evalSynthesisSpectrum(const double &f) const;
+
+  /** Returns a string identifying the type and the parameters of the wavelet, e.g.
+   * "Morlet(dff=2)". Wavelets with the same identifier are identical, hence the identifier is
+   * used to look up filter banks in the @c FilterBankCache. The default implementation returns
+   * an empty string, i.e. the wavelet can not be identified. */
+  virtual std::string identifier() const;
 };
 
 
@@ -56,11 +72,19 @@ public:
   virtual std::complex<double> evalSynthesis(const double &t) const;
   /** Evaluates the reproducing kernel located at time 0 and scale 1 at the given time and scale. */
   virtual std::complex<double> evalRepKern(const double &b, const double &a) const;
+  /** The Fourier transform is known. */
+  virtual bool hasSpectrum() const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalAnalysisSpectrum(const double &f) const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalSynthesisSpectrum(const double &f) const;
 
   /** Returns the with of the mother wavelet in the time domain. */
   virtual double cutOffTime() const;
   /** Returns the with of the mother wavelet in the frequency domain. */
   virtual double cutOffFreq() const;
+  /** Returns the identifier of the wavelet. */
+  virtual std::string identifier() const;
 
 protected:
   /** Holds the frequency resolution parameter. */
@@ -88,11 +112,19 @@ public:
   virtual std::complex<double> evalSynthesis(const double &t) const;
   /** Evaluates the reproducing kernel located at time 0 and scale 1 at the given time and scale. */
   virtual std::complex<double> evalRepKern(const double &b, const double &a) const;
+  /** The Fourier transform is known. */
+  virtual bool hasSpectrum() const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalAnalysisSpectrum(const double &f) const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalSynthesisSpectrum(const double &f) const;
 
   /** Returns the with of the mother wavelet in the time domain. */
   virtual double cutOffTime() const;
   /** Returns the with of the mother wavelet in the frequency domain. */
   virtual double cutOffFreq() const;
+  /** Returns the identifier of the wavelet. */
+  virtual std::string identifier() const;
 
 protected:
   /** Holds the frequency resolution parameter. */
@@ -120,6 +152,12 @@ public:
   virtual std::complex<double> evalSynthesis(const double &t) const;
   /** Evaluates the reproducing kernel located at time 0 and scale 1 at the given time and scale. */
   virtual std::complex<double> evalRepKern(const double &b, const double &a) const;
+  /** The Fourier transform is known. */
+  virtual bool hasSpectrum() const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalAnalysisSpectrum(const double &f) const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalSynthesisSpectrum(const double &f) const;
   /** Returns the normalization constant. */
   virtual double normConstant() const;
 
@@ -127,6 +165,8 @@ public:
   virtual double cutOffTime() const;
   /** Returns the width of the mother wavelet in the frequency domain. */
   virtual double cutOffFreq() const;
+  /** Returns the identifier of the wavelet. */
+  virtual std::string identifier() const;
 
 protected:
   /** Holds the order. */
@@ -156,6 +196,12 @@ public:
   virtual std::complex<double> evalSynthesis(const double &t) const;
   /** Evaluates the reproducing kernel located at time 0 and scale 1 at the given time and scale. */
   virtual std::complex<double> evalRepKern(const double &b, const double &a) const;
+  /** The Fourier transform is known. */
+  virtual bool hasSpectrum() const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalAnalysisSpectrum(const double &f) const;
+  /** Evaluates the Fourier transform of the mother wavelet at the specified frequency. */
+  virtual std::complex<double> evalSynthesisSpectrum(const double &f) const;
   /** Returns the normalization constant. */
   virtual double normConstant() const;
 
@@ -163,6 +209,8 @@ public:
   virtual double cutOffTime() const;
   /** Returns the width of the mother wavelet in the frequency domain. */
   virtual double cutOffFreq() const;
+  /** Returns the identifier of the wavelet. */
+  virtual std::string identifier() const;
 
 protected:
   /** Holds the order. */
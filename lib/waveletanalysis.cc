@@ -1,4 +1,5 @@
 #include "waveletanalysis.hh"
+#include <cmath>
 
 using namespace wt;
 
@@ -25,3 +26,32 @@ WaveletAnalysis::WaveletAnalysis(const WaveletAnalysis &other)
 WaveletAnalysis::~WaveletAnalysis() {
   // pass...
 }
+
+std::complex<double>
+WaveletAnalysis::sampledSpectrum(double f, double scale, double delay, bool synthesis) const {
+  std::complex<double> res = synthesis ? _wavelet.evalSynthesisSpectrum(scale*f) :
+                                         _wavelet.evalAnalysisSpectrum(scale*f);
+  // Sum aliases, at least up to twice the center frequency of the wavelet (1) and until they
+  // vanish.
+  for (int j=1; j<1000; j++) {
+    std::complex<double> pos = synthesis ? _wavelet.evalSynthesisSpectrum(scale*(f+j)) :
+                                           _wavelet.evalAnalysisSpectrum(scale*(f+j));
+    std::complex<double> neg = synthesis ? _wavelet.evalSynthesisSpectrum(scale*(f-j)) :
+                                           _wavelet.evalAnalysisSpectrum(scale*(f-j));
+    if ((scale*j > 2) && ((std::abs(pos)+std::abs(neg)) < 1e-12))
+      break;
+    res += pos*std::polar(1., -2*M_PI*j*delay) + neg*std::polar(1., 2*M_PI*j*delay);
+  }
+  return res;
+}
+
+std::string
+WaveletAnalysis::cacheKey(const std::string &kind) const {
+  std::string id = _wavelet.identifier();
+  if (id.empty())
+    return id;
+  // The scales are appended bitwise, hence only identical scales yield the same key
+  std::string key = kind + ";" + id + ";";
+  key.append(reinterpret_cast<const char *>(_scales.data()), _scales.size()*sizeof(double));
+  return key;
+}
@@ -7,6 +7,7 @@
 
 #include "types.hh"
 #include "api.hh"
+#include <string>
 
 namespace wt {
 
@@ -40,6 +41,20 @@ public:
   /** Returns the wavelet instance of this transform. */
   inline const Wavelet &wavelet() const { return _wavelet; }
 
+protected:
+  /** Evaluates the spectrum of the wavelet at @c scale sampled at unit intervals, i.e. the DTFT
+   * of \f$g((n-d)/a)/a\f$ at the frequency @c f (in cycles per sample), using the Fourier
+   * transform of the wavelet. Aliases (due to the sampling) are taken into account. The phase of
+   * the delay \f$d\f$, \f$e^{-2\pi i f d}\f$, is not included and must be applied by the caller.
+   * If @c synthesis is @c true, the synthesis wavelet is evaluated. */
+  std::complex<double> sampledSpectrum(double f, double scale, double delay,
+                                       bool synthesis=false) const;
+  /** Returns the key of the filter bank of this analysis in the @c FilterBankCache. The key
+   * combines the @c kind of the filter bank (i.e. the analysis, its options and precision), the
+   * identifier of the wavelet and the scales. Returns an empty key if the wavelet can not be
+   * identified, i.e. the filter bank must not be cached. */
+  std::string cacheKey(const std::string &kind) const;
+
 protected:
   /** The (mother-) wavelet to of the transform. */
   Wavelet _wavelet;
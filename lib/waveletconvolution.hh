@@ -2,15 +2,38 @@
 #define __WT_WAVELETCONVOLUTION_HH__
 
 #include <vector>
-#include "convolution.hh"
+#include <memory>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "filterbank.hh"
+#include "blocksink.hh"
 #include "waveletanalysis.hh"
+#include "wavelettransform.hh"
+#include "waveletsynthesis.hh"
 
 
 namespace wt {
 
 /** Implements the convolution operation in the wavelet time-scale space. That is, the
  * convolution of a time-scale function with the reproducing kernel of a wavelet pair.
- * @bug Not implemented yet.
+ *
+ * The integral over the input scales is evaluated by the trapezoidal rule. Input scales with
+ * similar kernel sizes are grouped into a single convolution summing over these inputs (see
+ * @c GenericConvolution), where the weights of the integration are folded into the kernels. Hence
+ * only one backward FFT per output scale and block is needed for each group. The kernels are
+ * shared with identical projections (see @c FilterBankCache).
+ *
+ * As the direct method evaluates the reproducing kernel for all pairs of input and output
+ * scales, its kernels and costs grow with the square of the number of scales K. Alternatively,
+ * the projection can be performed by the wavelet synthesis followed by the wavelet transform
+ * (@c SYNTHESIS), i.e. by 2K convolutions, where the filter bank of a transform passed to the
+ * constructor is reused. This is the composition of the synthesis and transform of this
+ * library, scaled by the ratio of the reproducing kernel and the convolution of the analysis
+ * and synthesis wavelets (see @c normalization, e.g. the parameter dff of the Morlet wavelet).
+ * Hence both algorithms yield the same quantity, for a band-limited signal they agree within
+ * about 1% (relative L2 error, Morlet wavelet).
  * @ingroup analysis */
 template <class Scalar>
 class GenericWaveletConvolution : public WaveletAnalysis
@@ -25,19 +48,64 @@ public:
   /** Complex matrix type. */
   typedef typename Traits<Scalar>::CMatrix CMatrix;
 
+  /** Possible projection algorithms. */
+  typedef enum {
+    DIRECT,     ///< Convolution with the reproducing kernel.
+    SYNTHESIS   ///< Wavelet synthesis followed by the wavelet transform.
+  } Algorithm;
+
+  /** Holds the buffers of the projection, i.e. a block of rows (spanning all scales) for every
+   * thread or the reconstructed signal and the buffers of the synthesis and transform. Passing
+   * the same workspace to subsequent projections avoids the repeated allocation of these
+   * buffers. A workspace must not be used by several projections at once. */
+  class Workspace
+  {
+  public:
+    /** Constructs an empty workspace, the buffers are allocated on first use. */
+    Workspace();
+
+  protected:
+    /** Returns the buffer of the calling thread. */
+    CMatrix &buffer();
+
+  protected:
+    /** The buffers of the threads. */
+    std::vector<CMatrix> _buffers;
+    /** The reconstructed signal (synthesis mode). */
+    CVector _signal;
+    /** The workspace of the synthesis (synthesis mode). */
+    typename GenericWaveletSynthesis<Scalar>::Workspace _synthesis;
+    /** The workspace of the transform (synthesis mode), created on first use. */
+    std::unique_ptr<typename GenericWaveletTransform<Scalar>::Workspace> _transform;
+
+    friend class GenericWaveletConvolution;
+  };
+
 public:
-  /** Constructs the convolution with the reproducting kernel of the specified wavelet pair. */
-  GenericWaveletConvolution(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales);
+  /** Constructs the convolution with the reproducting kernel of the specified wavelet pair,
+   * performed by the given @c algorithm. */
+  GenericWaveletConvolution(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                            Algorithm algorithm=DIRECT);
 
   /** Constructs the convolution with the reproducting kernel of the specified wavelet pair. */
-  GenericWaveletConvolution(const Wavelet &wavelet, double *scales, size_t Nscales);
+  GenericWaveletConvolution(const Wavelet &wavelet, double *scales, size_t Nscales,
+                            Algorithm algorithm=DIRECT);
 
-  /** Copy constructor. */
-  GenericWaveletConvolution(const WaveletAnalysis &other);
+  /** Copy constructor. If @c other is a @c GenericWaveletTransform and the @c SYNTHESIS
+   * algorithm is selected, its filter bank is reused. */
+  GenericWaveletConvolution(const WaveletAnalysis &other, Algorithm algorithm=DIRECT);
 
   /** Destructor. */
   virtual ~GenericWaveletConvolution();
 
+  /** Returns the projection algorithm. */
+  inline Algorithm algorithm() const { return _algorithm; }
+  /** Returns the factor applied to the composition of synthesis and transform (@c SYNTHESIS
+   * mode), i.e. the ratio of the reproducing kernel \f$K(b,a)\f$ and the convolution
+   * \f$\frac{1}{a}\int\psi((b-t)/a)\,\phi(t)\,dt\f$ of the analysis and synthesis wavelets. It is
+   * obtained at \f$b=0, a=1\f$ by numerical integration and is 1 in the direct mode. */
+  inline Complex normalization() const { return _normalization; }
+
   /** Performs the convolution of the @c transformed with the reproducing kernel and stores
    * the result into @c out. The optional @c progress allows to pass an instance implementing
    * the @c ProgressDelegateInterface. */
@@ -45,13 +113,51 @@ public:
   void operator() (const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
                    ProgressDelegateInterface *progress=0);
 
+  /** Performs the convolution with the reproducing kernel using the buffers of the given
+   * @c workspace. The contribution of each group of input scales is accumulated directly into
+   * @c out, block by block, where the blocks are processed in parallel. Hence, apart from the
+   * output, only a block of rows per thread (or the reconstructed signal) is held in memory. */
+  template <class iDerived, class oDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
+                   Workspace &workspace, ProgressDelegateInterface *progress=0);
+
+  /** Performs the convolution of the @c transformed with the reproducing kernel and passes the
+   * result in blocks of rows (spanning all scales) to the @c sink. The blocks are processed in
+   * parallel. In the synthesis mode, the blocks are passed by the transform, i.e. each block
+   * spans only a group of scales. */
+  template <class iDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &transformed, GenericBlockSink<Scalar> &sink,
+                   ProgressDelegateInterface *progress=0);
+
 protected:
-  /** Performs the initialization of the time-scale convolution operation. */
-  void _init_convolution();
+  /** Performs the initialization of the time-scale convolution operation. If @c other is not
+   * null, it provides the transform of the synthesis mode. */
+  void _init_convolution(const WaveletAnalysis *other=0);
+  /** Builds the groups of reproducing kernels into the given @c filterBank. */
+  void _init_filterBank(GenericFilterBank<Scalar> &filterBank) const;
+  /** Returns the number of groups of input scales. */
+  inline size_t _numGroups() const {
+    return this->_reprodKernel ? this->_reprodKernel->numGroups() : 0;
+  }
+  /** Returns the weights of the input scales for the trapezoidal integration over scales. */
+  Eigen::VectorXd _weights() const;
+  /** Returns the number of rows processed at once, spanning about 4 blocks of every kernel. */
+  ptrdiff_t _chunkSize() const;
 
 protected:
-  /** The list of convolution filters applied for the convolution with the reproducing kernel. */
-  std::vector<GenericConvolution<Scalar> *> _reprodKernel;
+  /** The convolution filters applied for the convolution with the reproducing kernel, one
+   * group for each group of input scales. */
+  std::shared_ptr<const GenericFilterBank<Scalar> > _reprodKernel;
+  /** The index of the first input scale of each group, followed by the number of scales. */
+  std::vector<size_t> _groups;
+  /** The projection algorithm. */
+  Algorithm _algorithm;
+  /** The factor applied to the result of the synthesis mode. */
+  Complex _normalization;
+  /** The synthesis (synthesis mode). */
+  std::unique_ptr<GenericWaveletSynthesis<Scalar> > _synthesis;
+  /** The transform (synthesis mode). */
+  std::unique_ptr<GenericWaveletTransform<Scalar> > _transform;
 };
 
 /// Default template instance for double precision.
@@ -60,65 +166,178 @@ typedef GenericWaveletConvolution<double> WaveletConvolution;
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of GenericWaveletConvolution::Workspace
+ * ********************************************************************************************* */
+template <class Scalar>
+wt::GenericWaveletConvolution<Scalar>::Workspace::Workspace()
+  : _buffers(), _signal(), _synthesis(), _transform()
+{
+  // pass...
+}
+
+template <class Scalar>
+typename wt::GenericWaveletConvolution<Scalar>::CMatrix &
+wt::GenericWaveletConvolution<Scalar>::Workspace::buffer() {
+  size_t t = 0;
+#ifdef _OPENMP
+  t = omp_get_thread_num();
+#endif
+  return _buffers[t];
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of GenericWaveletConvolution
  * ********************************************************************************************* */
 template<class Scalar>
 wt::GenericWaveletConvolution<Scalar>::GenericWaveletConvolution(
-    const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales)
-  : WaveletAnalysis(wavelet, scales), _reprodKernel()
+    const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales, Algorithm algorithm)
+  : WaveletAnalysis(wavelet, scales), _reprodKernel(), _groups(), _algorithm(algorithm),
+    _normalization(1), _synthesis(), _transform()
 {
   this->_init_convolution();
 }
 
 template <class Scalar>
-wt::GenericWaveletConvolution<Scalar>::GenericWaveletConvolution(const Wavelet &wavelet, double *scales, size_t Nscales)
-  : WaveletAnalysis(wavelet, scales, Nscales), _reprodKernel()
+wt::GenericWaveletConvolution<Scalar>::GenericWaveletConvolution(const Wavelet &wavelet, double *scales, size_t Nscales,
+                                                                 Algorithm algorithm)
+  : WaveletAnalysis(wavelet, scales, Nscales), _reprodKernel(), _groups(), _algorithm(algorithm),
+    _normalization(1), _synthesis(), _transform()
 {
   this->_init_convolution();
 }
 
 template <class Scalar>
-wt::GenericWaveletConvolution<Scalar>::GenericWaveletConvolution(const WaveletAnalysis &other)
-  : WaveletAnalysis(other), _reprodKernel()
+wt::GenericWaveletConvolution<Scalar>::GenericWaveletConvolution(const WaveletAnalysis &other,
+                                                                 Algorithm algorithm)
+  : WaveletAnalysis(other), _reprodKernel(), _groups(), _algorithm(algorithm),
+    _normalization(1), _synthesis(), _transform()
 {
-  this->_init_convolution();
+  this->_init_convolution(&other);
 }
 
 template <class Scalar>
 wt::GenericWaveletConvolution<Scalar>::~GenericWaveletConvolution() {
-  for (size_t i=0; i<_reprodKernel.size(); i++) {
-    delete _reprodKernel[i];
-  }
+  // pass...
 }
 
 template <class Scalar>
-void wt::GenericWaveletConvolution<Scalar>::_init_convolution() {
+void wt::GenericWaveletConvolution<Scalar>::_init_convolution(const WaveletAnalysis *other) {
   // Sort scales (ascending order)
   std::sort(_scales.derived().data(), _scales.derived().data()+_scales.size());
 
+  if (SYNTHESIS == _algorithm) {
+    logDebug() << "Construct wavelet projection on " << _scales.size() << " scales in ["
+               << _scales(0) << "," << _scales(_scales.size()-1)
+               << "] by synthesis and transform.";
+    // Reuse the filter bank of a given transform (a copy shares the filter bank)
+    const GenericWaveletTransform<Scalar> *transform =
+        dynamic_cast<const GenericWaveletTransform<Scalar> *>(other);
+    if (transform)
+      _transform.reset(new GenericWaveletTransform<Scalar>(*transform));
+    else
+      _transform.reset(new GenericWaveletTransform<Scalar>(*this));
+    _synthesis.reset(new GenericWaveletSynthesis<Scalar>(*this));
+    // The reproducing kernel K(b,a) at b=0, a=1 relative to the integral of psi(-t) phi(t),
+    // evaluated by the trapezoidal rule over 4 times the cut-off time
+    double T = 4*_wavelet.cutOffTime(), dt = T/2048;
+    std::complex<double> conv = 0;
+    for (int i=-2048; i<=2048; i++) {
+      double w = (2048 == std::abs(i)) ? dt/2 : dt;
+      conv += w * _wavelet.evalAnalysis(-i*dt) * _wavelet.evalSynthesis(i*dt);
+    }
+    _normalization = Complex(_wavelet.evalRepKern(0, 1)/conv);
+    logDebug() << "Normalization of the synthesis and transform: " << _normalization << ".";
+    return;
+  }
+
   logDebug() << "Construct wavelet projection on " << _scales.size() << " scales in ["
              << _scales(0) << "," << _scales(_scales.size()-1) << "].";
 
-  _reprodKernel.reserve(_scales.size());
+  // Reuse the kernels of an identical projection if there are some
+  std::ostringstream kind;
+  kind << "projection;" << sizeof(Scalar);
+  std::string key = this->cacheKey(kind.str());
+  if (! key.empty())
+    _reprodKernel = std::dynamic_pointer_cast<const GenericFilterBank<Scalar> >(
+          FilterBankCache::find(key));
+  if (! _reprodKernel) {
+    std::shared_ptr<GenericFilterBank<Scalar> > filterBank(new GenericFilterBank<Scalar>());
+    this->_init_filterBank(*filterBank);
+    _reprodKernel = filterBank;
+    FilterBankCache::insert(key, _reprodKernel);
+  }
 
-  // For every scale of the input ...
-  for (int i=0; i<_scales.size(); i++) {
-    // Determine the approx. time-scale range, the rep. kernel is supported on.
-    size_t N = FFT<Scalar>::roundUp(std::ceil(_scales[i]*2*_wavelet.cutOffTime()));
-    CMatrix kernel(N, _scales.size());
+  // The first input scale of each group, followed by the number of scales
+  _groups.assign(1, 0);
+  for (size_t g=0; g<_reprodKernel->numGroups(); g++)
+    _groups.push_back(_groups.back()+_reprodKernel->group(g).numInputs());
+  logDebug() << "Grouped " << _scales.size() << " input scales into "
+             << _reprodKernel->numGroups() << " convolutions.";
+  // done.
+}
 
-    // ...evaluate the kernel at every scale.
-    for (int j=0; j<_scales.size(); j++) {
-      for (size_t l=0; l<N; l++) {
-        kernel(l,j) = _wavelet.normConstant() *
-            _wavelet.evalRepKern((l-double(N)/2)/_scales[i], _scales[j]/_scales[i])
-            / _scales[i] / _scales[i];
+template <class Scalar>
+void
+wt::GenericWaveletConvolution<Scalar>::_init_filterBank(GenericFilterBank<Scalar> &filterBank) const {
+  // Determine the approx. time-scale range, the rep. kernel of every input scale is supported
+  // on. At equal scales, it is the convolution of two wavelets, hence sqrt(2) times as wide as
+  // the wavelet. Group neighbouring input scales, as long as the largest kernel of a group is at
+  // most twice as long as the smallest one. This bounds the zero-padding of the kernels (hence
+  // the memory of their spectra) while the backward FFTs are shared by all scales of a group.
+  ptrdiff_t K = _scales.size();
+  std::vector<size_t> sizes(K), groups;
+  for (ptrdiff_t i=0; i<K; i++) {
+    sizes[i] = FFT<Scalar>::roundUp(std::ceil(_scales[i]*2*M_SQRT2*_wavelet.cutOffTime()));
+    if ((0 == i) || (sizes[i] > 2*sizes[groups.back()]))
+      groups.push_back(i);
+  }
+  groups.push_back(K);
+
+  Eigen::VectorXd weights = this->_weights();
+  // For every group of input scales ...
+  for (size_t g=0; (g+1)<groups.size(); g++) {
+    size_t i0 = groups[g], G = groups[g+1]-i0, N = sizes[i0+G-1];
+    CMatrix kernel = CMatrix::Zero(N, G*K);
+    // ... evaluate the weighted kernel of every input scale at every output scale. Shorter
+    // kernels are centered within the N samples of the group.
+    for (size_t n=0; n<G; n++) {
+      size_t i = i0+n, Ni = sizes[i], offset = N/2-Ni/2;
+      for (ptrdiff_t j=0; j<K; j++) {
+        for (size_t l=0; l<Ni; l++) {
+          kernel(offset+l, n*K+j) = Complex(
+                weights(i) * _wavelet.normConstant() *
+                _wavelet.evalRepKern((l-double(Ni)/2)/_scales[i], _scales[j]/_scales[i])
+                / _scales[i] / _scales[i] );
+        }
       }
     }
-    _reprodKernel.push_back(new GenericConvolution<Scalar>(kernel));
+    filterBank.add(
+          new GenericConvolution<Scalar>(kernel, 1, false, ConvolutionStrategy::AUTO, 0, G));
   }
-  // done.
+}
+
+template <class Scalar>
+Eigen::VectorXd
+wt::GenericWaveletConvolution<Scalar>::_weights() const {
+  // The trapezoidal rule sum_i (s_i-s_{i-1})/2 (r_i+r_{i-1}) as a weighted sum of the r_i
+  ptrdiff_t K = this->_scales.size();
+  Eigen::VectorXd weights(K);
+  for (ptrdiff_t i=0; i<K; i++) {
+    weights(i) = (this->_scales(std::min(i+1, K-1)) - this->_scales(std::max(i-1, ptrdiff_t(0))))/2;
+  }
+  return weights;
+}
+
+template <class Scalar>
+ptrdiff_t
+wt::GenericWaveletConvolution<Scalar>::_chunkSize() const {
+  ptrdiff_t chunk = 1;
+  for (size_t i=0; i<this->_numGroups(); i++)
+    chunk = std::max(chunk,
+                     ptrdiff_t(4*this->_reprodKernel->group(i).strategy().blockLength()));
+  return chunk;
 }
 
 template <class Scalar>
@@ -128,25 +347,121 @@ wt::GenericWaveletConvolution<Scalar>::operator() (
     const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
     ProgressDelegateInterface *progress)
 {
+  Workspace workspace;
+  (*this)(transformed, out, workspace, progress);
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletConvolution<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
+    Workspace &workspace, ProgressDelegateInterface *progress)
+{
+  typedef typename oDerived::Scalar OComplex;
+  typedef typename GenericConvolution<Scalar>::Workspace ConvWorkspace;
+
   assertShapeNM(transformed, out.rows(), this->_scales.rows());
   assertShapeNM(out, transformed.rows(), this->_scales.rows());
-
-  CMatrix tempRes1(transformed.rows(), this->_scales.rows());
-  CMatrix tempRes2(transformed.rows(), this->_scales.rows());
   out.setZero();
 
-  // for every input scale
-  this->_reprodKernel[0]->apply(transformed.col(0), tempRes1);
-  for (int i=1; i<this->_scales.size(); i++) {
-    if (i & 1) // odd
-      this->_reprodKernel[i]->apply(transformed.col(i), tempRes2);
-    else // even
-      this->_reprodKernel[i]->apply(transformed.col(i), tempRes1);
-    out.derived() += ( (this->_scales(i)-this->_scales(i-1))/2 * (tempRes1+tempRes2) );
+  ptrdiff_t N = transformed.rows(), K = this->_scales.size();
+  if ((0 == N) || (0 == K))
+    return;
+
+  if (SYNTHESIS == _algorithm) {
+    // Reconstruct the signal and transform it again
+    workspace._signal.resize(N);
+    (*_synthesis)(transformed, workspace._signal, workspace._synthesis);
+    workspace._signal *= _normalization;
+    if ((! workspace._transform) ||
+        (workspace._transform->filterBank() != _transform->filterBank()))
+      workspace._transform.reset(
+            new typename GenericWaveletTransform<Scalar>::Workspace(*_transform));
+    (*_transform)(workspace._signal, out, *workspace._transform, OUTPUT_COMPLEX, 1, progress);
+    return;
+  }
+
+  ptrdiff_t chunk = this->_chunkSize(), nChunks = WT_IDIV_CEIL(N, chunk);
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  if (workspace._buffers.size() < size_t(nThreads))
+    workspace._buffers.resize(nThreads);
+
+  // Integrate over the input scales (trapezoidal rule) by accumulating the convolution of each
+  // group of input scales with the (weighted) reproducing kernels into the output, block by block
+  for (size_t g=0; g<this->_numGroups(); g++) {
+    const GenericConvolution<Scalar> &kernel = this->_reprodKernel->group(g);
+    ptrdiff_t i0 = this->_groups[g], G = this->_groups[g+1]-i0;
+    #pragma omp parallel
+    {
+      // The working memory of the kernel is only allocated by threads processing a block
+      std::unique_ptr<ConvWorkspace> ws;
+      CMatrix &current = workspace.buffer();
+      #pragma omp for schedule(static)
+      for (ptrdiff_t c=0; c<nChunks; c++) {
+        ptrdiff_t r0 = c*chunk, r1 = std::min(r0+chunk, N);
+        if (! ws)
+          ws.reset(new ConvWorkspace(kernel));
+        current.resize(r1-r0, K);
+        kernel.applyBlock(transformed.middleCols(i0, G), current, *ws, r0, r1, r0, N);
+        out.derived().middleRows(r0, r1-r0) += current.template cast<OComplex>();
+      }
+    }
     if (progress)
-      (*progress)(double(i+1)/this->scales().size());
+      (*progress)(double(i0+G)/K);
   }
 }
 
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericWaveletConvolution<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &transformed, GenericBlockSink<Scalar> &sink,
+    ProgressDelegateInterface *progress)
+{
+  ptrdiff_t N = transformed.rows(), K = this->_scales.size();
+  assertShapeNM(transformed, N, K);
+  if ((0 == N) || (0 == K))
+    return;
+
+  if (SYNTHESIS == _algorithm) {
+    // Only the reconstructed signal is held in memory
+    CVector signal(N);
+    (*_synthesis)(transformed, signal);
+    signal *= _normalization;
+    (*_transform)(signal, sink, progress);
+    return;
+  }
+
+  // Process chunks of rows spanning about 4 blocks of every kernel
+  ptrdiff_t chunk = this->_chunkSize(), nChunks = WT_IDIV_CEIL(N, chunk);
+
+  #pragma omp parallel
+  {
+    // Each thread keeps the workspaces of all groups of input scales, allocated on first use,
+    // across the chunks it processes
+    typename GenericFilterBank<Scalar>::Workspace groups(*this->_reprodKernel);
+    CMatrix current, acc;
+
+    #pragma omp for schedule(dynamic, 1)
+    for (ptrdiff_t c=0; c<nChunks; c++) {
+      ptrdiff_t r0 = c*chunk, r1 = std::min(r0+chunk, N);
+      // The chunks are handed out in order, hence the chunk index reports the progress
+      if (progress)
+        (*progress)(double(c)/nChunks);
+      current.resize(r1-r0, K); acc.setZero(r1-r0, K);
+      for (size_t g=0; g<this->_numGroups(); g++) {
+        const GenericConvolution<Scalar> &kernel = this->_reprodKernel->group(g);
+        ptrdiff_t i0 = this->_groups[g], G = this->_groups[g+1]-i0;
+        kernel.applyBlock(transformed.middleCols(i0, G), current, groups[g], r0, r1, r0, N);
+        acc += current;
+      }
+      sink(r0, 0, acc);
+    }
+  }
+}
 
 #endif // __WT_WAVELETCONVOLUTION_HH__
@@ -2,14 +2,27 @@
 #define __WT_WAVELETSYNTHESIS_HH__
 
 #include "waveletanalysis.hh"
-#include "convolution.hh"
+#include "filterbank.hh"
+#include "blocksink.hh"
 #include <vector>
+#include <memory>
+#include <sstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 namespace wt {
 
 /** Implements the wavelet synthesis, means the reconstruction of the signal from
  * a wavelet transformed.
+ *
+ * The integral over scales is evaluated by the trapezoidal rule. Neighbouring scales with
+ * similar kernel sizes are grouped into a single convolution summing over these scales (see
+ * @c GenericConvolution), where the weights of the integration are folded into the kernels.
+ * Hence the filtered spectra of a group are accumulated in the frequency domain and only one
+ * backward FFT per block is needed for each group. The filter bank is shared with identical
+ * syntheses (see @c FilterBankCache).
  * @ingroup analyses */
 template <class Scalar>
 class GenericWaveletSynthesis: public WaveletAnalysis
@@ -24,9 +37,39 @@ public:
   /// Complex matrix type.
   typedef typename Traits<Scalar>::CMatrix CMatrix;
 
+  /** Holds the buffers of the synthesis, i.e. a block of rows and the working memory of the
+   * filter bank for every thread. Passing the same workspace to subsequent syntheses avoids the
+   * repeated allocation of these buffers. A workspace must not be used by several syntheses at
+   * once. */
+  class Workspace
+  {
+  public:
+    /** Constructs an empty workspace, the buffers are allocated on first use. */
+    Workspace();
+
+  protected:
+    /** Prepares the buffers of @c threads threads for the filter bank @c bank. The working
+     * memory allocated for another filter bank is dropped. */
+    void prepare(const std::shared_ptr<const GenericFilterBank<Scalar> > &bank, size_t threads);
+    /** Returns the buffer of the calling thread. */
+    CVector &buffer();
+    /** Returns the working memory of the filter bank for the calling thread. */
+    typename GenericFilterBank<Scalar>::Workspace &thread();
+
+  protected:
+    /** The buffers of the threads. */
+    std::vector<CVector> _buffers;
+    /** The filter bank the working memory of the threads belongs to. */
+    std::shared_ptr<const GenericFilterBank<Scalar> > _bank;
+    /** The working memory of the filter bank for every thread. */
+    std::vector< std::unique_ptr<typename GenericFilterBank<Scalar>::Workspace> > _threads;
+
+    friend class GenericWaveletSynthesis;
+  };
+
 public:
   /** Constructor. */
-  GenericWaveletSynthesis(const Wavelet &wavelet, const RVector &scales);
+  GenericWaveletSynthesis(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales);
 
   /** Constructor using double pointers for the python/numpy interface. */
   GenericWaveletSynthesis(const Wavelet &wavelet, double *scales, int Nscales);
@@ -37,18 +80,44 @@ public:
   /** Destructor. */
   virtual ~GenericWaveletSynthesis();
 
-  /** Performs the wavelet synthesis. */
+  /** Performs the wavelet synthesis. The integration over the groups of scales is performed in
+   * the precision of @c out. Hence a single precision synthesis may accumulate in double
+   * precision by passing a double precision output vector. */
   template <class iDerived, class oDerived>
   void operator() (const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
                    ProgressDelegateInterface *progress=0);
 
+  /** Performs the wavelet synthesis using the buffers of the given @c workspace. The
+   * contribution of each group of scales is accumulated directly into @c out, block by block,
+   * where the blocks are processed in parallel. Hence, apart from the output, only a block of
+   * rows per thread is held in memory. */
+  template <class iDerived, class oDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
+                   Workspace &workspace, ProgressDelegateInterface *progress=0);
+
+  /** Performs the wavelet synthesis and passes the reconstructed signal in blocks of rows to the
+   * @c sink, i.e. the reconstruction is never held completely in memory. The blocks are
+   * processed in parallel. */
+  template <class iDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &transformed, GenericBlockSink<Scalar> &sink,
+                   ProgressDelegateInterface *progress=0);
+
 protected:
   /** Initializes the filter bank for the synthesis operation. */
   void init_synthesis();
+  /** Builds the groups of kernels of the synthesis into the given @c filterBank. */
+  void init_filterBank(GenericFilterBank<Scalar> &filterBank) const;
+  /** Returns the weights of the scales for the trapezoidal integration over scales. */
+  Eigen::VectorXd _weights() const;
+  /** Returns the number of rows processed at once, spanning about 4 blocks of every filter. */
+  ptrdiff_t _chunkSize() const;
 
 protected:
-  /** The list of convolution filters applied for the wavelet synthesis. */
-  std::vector<GenericConvolution<Scalar> *> _filterBank;
+  /** The convolution filters applied for the wavelet synthesis, one group for each group of
+   * scales. */
+  std::shared_ptr<const GenericFilterBank<Scalar> > _filterBank;
+  /** The index of the first scale of each group, followed by the number of scales. */
+  std::vector<size_t> _groups;
 };
 
 typedef GenericWaveletSynthesis<double> WaveletSynthesis;
@@ -57,34 +126,82 @@ typedef GenericWaveletSynthesis<double> WaveletSynthesis;
 
 
 
+/* ********************************************************************************************* *
+ * Implementation of GenericWaveletSynthesis::Workspace
+ * ********************************************************************************************* */
+template <class Scalar>
+wt::GenericWaveletSynthesis<Scalar>::Workspace::Workspace()
+  : _buffers(), _bank(), _threads()
+{
+  // pass...
+}
+
+template <class Scalar>
+void
+wt::GenericWaveletSynthesis<Scalar>::Workspace::prepare(
+    const std::shared_ptr<const GenericFilterBank<Scalar> > &bank, size_t threads)
+{
+  if (bank != _bank) {
+    _threads.clear();
+    _bank = bank;
+  }
+  if (_buffers.size() < threads)
+    _buffers.resize(threads);
+  if (_threads.size() < threads)
+    _threads.resize(threads);
+}
+
+template <class Scalar>
+typename wt::GenericWaveletSynthesis<Scalar>::CVector &
+wt::GenericWaveletSynthesis<Scalar>::Workspace::buffer() {
+  size_t t = 0;
+#ifdef _OPENMP
+  t = omp_get_thread_num();
+#endif
+  return _buffers[t];
+}
+
+template <class Scalar>
+typename wt::GenericFilterBank<Scalar>::Workspace &
+wt::GenericWaveletSynthesis<Scalar>::Workspace::thread() {
+  size_t t = 0;
+#ifdef _OPENMP
+  t = omp_get_thread_num();
+#endif
+  // The workspaces of the groups are allocated on first use
+  if (! _threads[t])
+    _threads[t].reset(new typename GenericFilterBank<Scalar>::Workspace(*_bank));
+  return *_threads[t];
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of GenericWaveletSynthesis
  * ********************************************************************************************* */
 template <class Scalar>
-wt::GenericWaveletSynthesis<Scalar>::GenericWaveletSynthesis(const Wavelet &wavelet, const RVector &scales)
-  : WaveletAnalysis(wavelet, scales), _filterBank()
+wt::GenericWaveletSynthesis<Scalar>::GenericWaveletSynthesis(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales)
+  : WaveletAnalysis(wavelet, scales), _filterBank(), _groups()
 {
   this->init_synthesis();
 }
 
 template <class Scalar>
 wt::GenericWaveletSynthesis<Scalar>::GenericWaveletSynthesis(const Wavelet &wavelet, double *scales, int Nscales)
-  : WaveletAnalysis(wavelet, scales, Nscales), _filterBank()
+  : WaveletAnalysis(wavelet, scales, Nscales), _filterBank(), _groups()
 {
   this->init_synthesis();
 }
 
 template <class Scalar>
 wt::GenericWaveletSynthesis<Scalar>::GenericWaveletSynthesis(const WaveletAnalysis &other)
-  : WaveletAnalysis(other), _filterBank()
+  : WaveletAnalysis(other), _filterBank(), _groups()
 {
   this->init_synthesis();
 }
 
 template <class Scalar>
 wt::GenericWaveletSynthesis<Scalar>::~GenericWaveletSynthesis() {
-  typename std::vector<GenericConvolution<Scalar> *>::iterator filter = _filterBank.begin();
-  for (; filter != _filterBank.end(); filter++) { delete *filter; }
+  // pass...
 }
 
 template <class Scalar>
@@ -96,26 +213,102 @@ wt::GenericWaveletSynthesis<Scalar>::init_synthesis() {
   logDebug() << "Construct wavelet synthesis over " << _scales.size() << " scales in ["
              << _scales(0) << "," << _scales(_scales.size()-1) << "].";
 
-  Eigen::VectorXd dScale(_scales.size());
-  for (size_t i=1; i<_scales.size(); i++) {
-    dScale(i) = _scales(i)-_scales(i-1);
+  // Reuse the filter bank of an identical synthesis if there is one
+  std::ostringstream kind;
+  kind << "synthesis;" << sizeof(Scalar);
+  std::string key = this->cacheKey(kind.str());
+  if (! key.empty())
+    _filterBank = std::dynamic_pointer_cast<const GenericFilterBank<Scalar> >(
+          FilterBankCache::find(key));
+  if (! _filterBank) {
+    std::shared_ptr<GenericFilterBank<Scalar> > filterBank(new GenericFilterBank<Scalar>());
+    this->init_filterBank(*filterBank);
+    _filterBank = filterBank;
+    FilterBankCache::insert(key, _filterBank);
   }
-  dScale(0) = dScale(1);
 
-  _filterBank.clear();
-  _filterBank.reserve(_scales.size());
+  // The first scale of each group, followed by the number of scales
+  _groups.assign(1, 0);
+  for (size_t g=0; g<_filterBank->numGroups(); g++)
+    _groups.push_back(_groups.back()+_filterBank->group(g).numInputs());
+  logDebug() << "Grouped " << _scales.size() << " scales into " << _filterBank->numGroups()
+             << " convolutions.";
+}
+
+template <class Scalar>
+void
+wt::GenericWaveletSynthesis<Scalar>::init_filterBank(GenericFilterBank<Scalar> &filterBank) const {
   // Determine kernel size for every scale and round up to next integer for which the FFT can
-  // be computed fast. Also group the resulting kernel lengths
-  for (int j=0; j<_scales.size(); j++) {
-    size_t N = FFT<Scalar>::roundUp(std::ceil(_scales[j]*2*_wavelet.cutOffTime()));
-    CVector kernel(N);
-    for (size_t i=0; i<N; i++) {
-      kernel(i) = _wavelet.normConstant() *
-          _wavelet.evalSynthesis((i-double(N)/2)/_scales[j]) /
-          _scales[j]/_scales[j];
+  // be computed fast. Group neighbouring scales, as long as the largest kernel of a group is at
+  // most twice as long as the smallest one (see GenericWaveletConvolution).
+  ptrdiff_t K = _scales.size();
+  std::vector<size_t> sizes(K), groups;
+  for (ptrdiff_t j=0; j<K; j++) {
+    sizes[j] = FFT<Scalar>::roundUp(std::ceil(_scales[j]*2*_wavelet.cutOffTime()));
+    if ((0 == j) || (sizes[j] > 2*sizes[groups.back()]))
+      groups.push_back(j);
+  }
+  groups.push_back(K);
+
+  Eigen::VectorXd weights = this->_weights();
+  for (size_t g=0; (g+1)<groups.size(); g++) {
+    size_t j0 = groups[g], G = groups[g+1]-j0, N = sizes[j0+G-1];
+    // If the Fourier transform of the wavelet is known, sample the spectra of the weighted
+    // kernels directly. Shorter kernels are centered within the N samples of the group, i.e.
+    // delayed by N/2-Nj/2.
+    if (_wavelet.hasSpectrum()) {
+      GenericConvolution<Scalar> *filter =
+          new GenericConvolution<Scalar>(N, 1, 1, false, ConvolutionStrategy::AUTO, 0, G);
+      CMatrix &spectrum = filter->kernelSpectra();
+      double P = filter->fftSize();
+      for (size_t n=0; n<G; n++) {
+        size_t j = j0+n, Nj = sizes[j], offset = N/2-Nj/2;
+        for (int i=0; i<spectrum.rows(); i++) {
+          double f = filter->frequency(i);
+          spectrum(i,n) = Complex(
+                std::polar(weights(j)*_wavelet.normConstant()/_scales[j]/P,
+                           -M_PI*f*Nj - 2*M_PI*f*offset) *
+                sampledSpectrum(f, _scales[j], double(Nj)/2, true) );
+        }
+      }
+      // The sampled spectra describe periodic kernels, limit them to N samples
+      filter->limitKernels();
+      filterBank.add(filter);
+      continue;
+    }
+    CMatrix kernel = CMatrix::Zero(N, G);
+    for (size_t n=0; n<G; n++) {
+      size_t j = j0+n, Nj = sizes[j], offset = N/2-Nj/2;
+      for (size_t i=0; i<Nj; i++) {
+        kernel(offset+i, n) = Complex( weights(j) * _wavelet.normConstant() *
+                                       _wavelet.evalSynthesis((i-double(Nj)/2)/_scales[j]) /
+                                       _scales[j]/_scales[j] );
+      }
     }
-    _filterBank.push_back(new GenericConvolution<Scalar>(kernel));
+    filterBank.add(
+          new GenericConvolution<Scalar>(kernel, 1, false, ConvolutionStrategy::AUTO, 0, G));
+  }
+}
+
+template <class Scalar>
+Eigen::VectorXd
+wt::GenericWaveletSynthesis<Scalar>::_weights() const {
+  // The trapezoidal rule sum_j (s_j-s_{j-1})/2 (r_j+r_{j-1}) as a weighted sum of the r_j
+  ptrdiff_t K = this->_scales.size();
+  Eigen::VectorXd weights(K);
+  for (ptrdiff_t j=0; j<K; j++) {
+    weights(j) = (this->_scales[std::min(j+1, K-1)] - this->_scales[std::max(j-1, ptrdiff_t(0))])/2;
   }
+  return weights;
+}
+
+template <class Scalar>
+ptrdiff_t
+wt::GenericWaveletSynthesis<Scalar>::_chunkSize() const {
+  ptrdiff_t chunk = 1;
+  for (size_t j=0; j<this->_filterBank->numGroups(); j++)
+    chunk = std::max(chunk, ptrdiff_t(4*this->_filterBank->group(j).strategy().blockLength()));
+  return chunk;
 }
 
 template <class Scalar>
@@ -125,28 +318,98 @@ wt::GenericWaveletSynthesis<Scalar>::operator() (
     const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
     ProgressDelegateInterface *progress)
 {
-  CVector last(transformed.rows()), current(transformed.rows());
+  Workspace workspace;
+  (*this)(transformed, out, workspace, progress);
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletSynthesis<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &transformed, Eigen::DenseBase<oDerived> &out,
+    Workspace &workspace, ProgressDelegateInterface *progress)
+{
+  // Accumulate in the precision of the output vector
+  typedef typename oDerived::Scalar OComplex;
+
   // Clear output vector
   out.setZero();
 
-  // If there is no filter bank -> done.
-  if (0 == this->_filterBank.size())
+  ptrdiff_t N = transformed.rows(), K = this->_scales.size();
+  if ((0 == N) || (0 == K))
     return;
 
-  // Apply first scale
-  this->_filterBank[0]->apply(transformed.col(0), last);
-  // Iterate over all scales and integrate over scales (mid-point method)
-  for (size_t j=1; j<this->_filterBank.size(); j++) {
-    // Perform FFT convolution
-    this->_filterBank[j]->apply(transformed.col(j), current);
-    out.head(transformed.rows()) += ((this->_scales[j]-this->_scales[j-1])/2)*(current+last);
-    // store current into last
-    last.swap(current);
+  ptrdiff_t chunk = this->_chunkSize(), nChunks = WT_IDIV_CEIL(N, chunk);
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  workspace.prepare(this->_filterBank, nThreads);
+
+  // Integrate over scales (trapezoidal rule) by accumulating the contribution of each group of
+  // scales into the output, block by block
+  for (size_t g=0; g<this->_filterBank->numGroups(); g++) {
+    const GenericConvolution<Scalar> &filter = this->_filterBank->group(g);
+    ptrdiff_t j0 = this->_groups[g], G = this->_groups[g+1]-j0;
+    #pragma omp parallel
+    {
+      // The working memory of the filter is kept by the workspace and only allocated by threads
+      // processing a block
+      typename GenericFilterBank<Scalar>::Workspace &groups = workspace.thread();
+      CVector &current = workspace.buffer();
+      #pragma omp for schedule(static)
+      for (ptrdiff_t i=0; i<nChunks; i++) {
+        ptrdiff_t r0 = i*chunk, r1 = std::min(r0+chunk, N);
+        current.resize(r1-r0);
+        filter.applyBlock(transformed.middleCols(j0, G), current, groups[g], r0, r1, r0, N);
+        out.derived().segment(r0, r1-r0) += current.template cast<OComplex>();
+      }
+    }
     if (progress)
-      (*progress)(double(j)/this->_filterBank.size());
+      (*progress)(double(j0+G)/K);
   }
 }
 
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericWaveletSynthesis<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &transformed, GenericBlockSink<Scalar> &sink,
+    ProgressDelegateInterface *progress)
+{
+  typedef typename GenericConvolution<Scalar>::Workspace ConvWorkspace;
+  ptrdiff_t N = transformed.rows(), K = this->_scales.size();
+  if ((0 == N) || (0 == K))
+    return;
+
+  // Process chunks of rows spanning about 4 blocks of every filter
+  ptrdiff_t chunk = this->_chunkSize(), nChunks = WT_IDIV_CEIL(N, chunk);
+
+  #pragma omp parallel
+  {
+    // Each thread uses its own working memory for every group of scales
+    std::vector<std::unique_ptr<ConvWorkspace> > workspaces(this->_filterBank->numGroups());
+    CVector current, acc;
+
+    #pragma omp for schedule(dynamic, 1)
+    for (ptrdiff_t i=0; i<nChunks; i++) {
+      ptrdiff_t r0 = i*chunk, r1 = std::min(r0+chunk, N);
+      // The chunks are handed out in order, hence the chunk index reports the progress
+      if (progress)
+        (*progress)(double(i)/nChunks);
+      current.resize(r1-r0); acc.setZero(r1-r0);
+      for (size_t g=0; g<this->_filterBank->numGroups(); g++) {
+        const GenericConvolution<Scalar> &filter = this->_filterBank->group(g);
+        ptrdiff_t j0 = this->_groups[g], G = this->_groups[g+1]-j0;
+        if (! workspaces[g])
+          workspaces[g].reset(new ConvWorkspace(filter));
+        filter.applyBlock(transformed.middleCols(j0, G), current, *workspaces[g], r0, r1, r0, N);
+        acc += current;
+      }
+      sink(r0, 0, acc);
+    }
+  }
+}
 
 
 #endif // __WT_WAVELETSYNTHESIS_HH__
@@ -2,14 +2,48 @@
 #define __WAVELETTRANSFORM_HH__
 
 #include "waveletanalysis.hh"
-#include "convolution.hh"
+#include "exception.hh"
+#include "filterbank.hh"
+#include "mappedmatrix.hh"
+#include "blocksink.hh"
+#include "binaryio.hh"
 #include <vector>
 #include <list>
+#include <type_traits>
+#include <memory>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cmath>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 namespace wt {
 
 /** Implements a complex, continious wavelet transform (i.e. \cite Holschneider1998).
+ *
+ * Real valued signals are transformed using real-to-complex FFTs. For progressive wavelets
+ * (e.g., Morlet and Cauchy), the transform can be performed in the analytic mode, where the
+ * negative frequencies of the scaled wavelets are neglected.
+ *
+ * Several channels sharing the same scales can be transformed at once. Then the filter bank is
+ * shared, the forward FFTs are batched over the channels and the work is distributed over
+ * channels and groups of scales. Expensive groups are further split into ranges of samples and
+ * tiles of scales, the most expensive parts are scheduled first.
+ *
+ * In the causal mode, the kernels are truncated to their past half and re-normalized. Then the
+ * transform at time t depends only on the samples up to t, at the price of a group delay of about
+ * the half-width of the wavelet at each scale (see @c groupDelays). The interpolation of
+ * sub-sampled scales would look ahead by up to two sub-sampling intervals, hence these kernels
+ * are delayed by two further sub-samples.
+ *
+ * The kernels are held by an immutable @c GenericFilterBank, which is shared by copies of the
+ * transform and by identical transforms (see @c FilterBankCache). A transform can be saved
+ * together with its filter bank (see @c save). Loading it avoids the construction of the filter
+ * bank. As the scratch buffers are allocated per call and thread, a transform can be applied
+ * concurrently from several threads.
  * @ingroup analyses */
 template <class Scalar>
 class GenericWaveletTransform: public WaveletAnalysis
@@ -23,37 +57,192 @@ public:
   typedef typename Traits<Scalar>::CVector CVector;
   /// Complex valued matrix type.
   typedef typename Traits<Scalar>::CMatrix CMatrix;
+  /// Real valued matrix type.
+  typedef typename Traits<Scalar>::RMatrix RMatrix;
+
+  /** Holds the buffers of a transform, i.e. the sub-sampled signals of the groups and the
+   * working memory of every thread. Passing the same workspace to subsequent transforms of
+   * signals of the same size avoids the repeated allocation of these buffers. A workspace must
+   * not be used by several transforms at once. */
+  class Workspace
+  {
+  public:
+    /** Constructs an empty workspace for the given @c transform, the buffers are allocated on
+     * first use. */
+    Workspace(const GenericWaveletTransform &transform);
+
+    /** Returns the filter bank of the transform the workspace was constructed for. */
+    inline const std::shared_ptr<const GenericFilterBank<Scalar> > &filterBank() const {
+      return _bank;
+    }
+
+  protected:
+    /** Returns the workspace of the calling thread, transforming batches of @c channels. */
+    typename GenericFilterBank<Scalar>::Workspace &thread(size_t channels);
+    /** Returns the sub-sampled complex signals of the groups. */
+    inline std::vector<CMatrix> &subSignals(std::true_type) { return _csub; }
+    /** Returns the sub-sampled real signals of the groups. */
+    inline std::vector<RMatrix> &subSignals(std::false_type) { return _rsub; }
+
+  protected:
+    /** The filter bank of the transform. */
+    std::shared_ptr<const GenericFilterBank<Scalar> > _bank;
+    /** The sub-sampled complex signals of the groups. */
+    std::vector<CMatrix> _csub;
+    /** The sub-sampled real signals of the groups. */
+    std::vector<RMatrix> _rsub;
+    /** The working memory of every thread. */
+    std::vector< std::unique_ptr<typename GenericFilterBank<Scalar>::Workspace> > _threads;
+
+    friend class GenericWaveletTransform;
+  };
 
 public:
-  /** Constructs a wavelet transform from the given @c wavelet at the specified @c scales. */
-  GenericWaveletTransform(const Wavelet &wavelet, const Eigen::Ref<const RVector> &scales, bool subSample=false);
+  /** Constructs a wavelet transform from the given @c wavelet at the specified @c scales.
+   * If @c analytic is @c true, the negative frequencies of the wavelets are neglected. If
+   * @c causal is @c true, the transform at time t does not depend on samples after t (see
+   * @c groupDelays). */
+  GenericWaveletTransform(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales,
+                          bool subSample=false, bool analytic=false, bool causal=false);
 
   /** Constructs a wavelet transform from the given @c wavelet at the specified @c scales. */
-  GenericWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, bool subSample=false);
+  GenericWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales,
+                          bool subSample=false, bool analytic=false, bool causal=false);
 
   /** Constructor from other wavelet analysis. */
-  GenericWaveletTransform(const WaveletAnalysis &other, bool subSample=false);
+  GenericWaveletTransform(const WaveletAnalysis &other, bool subSample=false,
+                          bool analytic=false, bool causal=false);
+
+  /** Loads a transform saved by @c save from the stream @c in. The loaded filter bank is not put
+   * into the @c FilterBankCache, hence a stale or corrupt file does not affect other
+   * transforms. Throws an @c IOError if the stream does not hold a valid transform of the same
+   * precision. */
+  GenericWaveletTransform(std::istream &in);
 
   /** Destructor. */
   virtual ~GenericWaveletTransform();
 
+  /** Returns @c true if the transform is causal. */
+  inline bool causal() const { return _causal; }
+  /** Returns the group delay (in samples) of every scale. For the causal transform, the kernels
+   * are truncated to their past half, hence the response to an event is delayed by
+   * approximately the half-width of the wavelet (plus two sub-sampling intervals for sub-sampled
+   * scales). Otherwise the kernels are centered and the delays are 0. */
+  inline const Eigen::VectorXd &groupDelays() const { return _groupDelays; }
+
+  /** Returns the filter bank of the transform. */
+  inline const std::shared_ptr<const GenericFilterBank<Scalar> > &filterBank() const {
+    return _filterBank;
+  }
+
+  /** Saves the transform, i.e. the wavelet, the scales, the options and the filter bank, to the
+   * stream @c out in a versioned binary format. Throws a @c ValueError if the wavelet can not be
+   * identified (see @c Wavelet::identifier) and an @c IOError on failure. */
+  void save(std::ostream &out) const;
+  /** Saves the transform to the file @c filename. */
+  void save(const std::string &filename) const;
+  /** Loads a transform from the file @c filename (see @c save). */
+  static GenericWaveletTransform load(const std::string &filename);
+
   /** Performs the wavelet transform on the given @c signal and stores the result into the given
    * @c out matrix. The wavelet transformed for the j-th scale is stored in the j-th column
    * of the matrix, hence the matrix must have N rows and K colmums where K is the number of scales
-   * and N is the number of samples in signal. */
+   * and N is the number of samples in signal.
+   *
+   * If the signal has C columns (channels), the output must have K*C columns, where the
+   * transform of the c-th channel is stored in the columns [c*K, (c+1)*K). */
+  template <class iDerived, class oDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                   ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the wavelet transform on the given @c signal but stores only every
+   * @c decimation-th row of the result, i.e. the transform at the times 0, D, 2D, ... Hence
+   * @c out must have ceil(N/D) rows (and K*C columns). The interpolation of the skipped rows
+   * of sub-sampled scales is not performed at all. */
+  template <class iDerived, class oDerived>
+  void decimated(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                 size_t decimation, ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the wavelet transform on the given @c signal and stores the quantity @c output
+   * (e.g., the power or the phase) of the result into @c out. Unless @c output is
+   * @c OUTPUT_COMPLEX, @c out must be a real (float or double) matrix. The quantity is computed
+   * by the epilogue of the convolutions, hence the complex transform is never stored. Throws a
+   * @c ValueError if the type of @c out does not match @c output. */
   template <class iDerived, class oDerived>
   void operator() (const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
-                   ProgressDelegateInterface *progress=0);
+                   OutputMode output, ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the decimated wavelet transform (see @c decimated) and stores the quantity
+   * @c output of the result into @c out. */
+  template <class iDerived, class oDerived>
+  void decimated(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                 size_t decimation, OutputMode output,
+                 ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the wavelet transform like @c decimated, but keeps the buffers in the given
+   * @c workspace. Hence, transforming a sequence of signals of the same size does not allocate
+   * any memory after the first transform. */
+  template <class iDerived, class oDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                   Workspace &workspace, OutputMode output=OUTPUT_COMPLEX, size_t decimation=1,
+                   ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the wavelet transform on the given @c signal into a memory mapped file. The
+   * output must have N rows and K*C columns. The groups of scales are transformed one after
+   * another and the finished columns are released from memory, hence the result may exceed
+   * the available memory. */
+  template <class iDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &signal, GenericMappedMatrix<Scalar> &out,
+                   ProgressDelegateInterface *progress=0) const;
+
+  /** Performs the wavelet transform on the given @c signal and passes the result in blocks to
+   * the @c sink instead of storing it into a matrix. Each block holds a range of rows of a group
+   * of scales of a channel, where the columns are numbered like the output matrix of the
+   * transform. Only a few blocks per thread are held in memory at any time. */
+  template <class iDerived>
+  void operator() (const Eigen::DenseBase<iDerived> &signal, GenericBlockSink<Scalar> &sink,
+                   ProgressDelegateInterface *progress=0) const;
+
+  /** Like the @c sink variant above, but passes only every @c decimation-th row of the result
+   * (see @c decimated). */
+  template <class iDerived>
+  void decimated(const Eigen::DenseBase<iDerived> &signal, GenericBlockSink<Scalar> &sink,
+                 size_t decimation, ProgressDelegateInterface *progress=0) const;
 
 protected:
   /** Actually initializes the transformation. */
   void init_trafo();
+  /** Returns the kind of the filter bank, i.e. the precision and the options of the transform,
+   * for the @c FilterBankCache. */
+  std::string cacheKind() const;
+  /** Turns the centered @c kernel into a causal one, i.e. truncates the samples before its
+   * center, removes the mean and restores the L1-norm of the full kernel. Returns the group
+   * delay of the kernel in samples. */
+  static double causalKernel(Eigen::Ref<CVector> kernel);
+  /** Computes the sub-sampled @c signal for every group in [g0, g1) using sub-sampling into
+   * the @c workspace and returns the sub-sampled signals of all groups. */
+  template <class iDerived>
+  std::vector<typename std::conditional<
+      Eigen::NumTraits<typename iDerived::Scalar>::IsComplex, CMatrix, RMatrix>::type> &
+  _subSignals(const Eigen::DenseBase<iDerived> &signal, Workspace &workspace,
+              size_t g0, size_t g1) const;
+  /** Applies the groups [g0, g1) of the filter bank. */
+  template <class iDerived, class oDerived>
+  void _transform(const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+                  Workspace &workspace, size_t decimation, OutputMode output,
+                  ProgressDelegateInterface *progress, size_t g0, size_t g1) const;
 
 protected:
   /** If @c true, the sub-sampling of the input signal is allowed. */
   bool _subSample;
-  /** The list of convolution filters applied for the wavelet transform. */
-  std::vector<GenericConvolution<Scalar> *> _filterBank;
+  /** If @c true, the negative frequencies of the wavelets are neglected. */
+  bool _analytic;
+  /** If @c true, the kernels are truncated to their past half. */
+  bool _causal;
+  /** The group delay of every scale. */
+  Eigen::VectorXd _groupDelays;
+  /** The groups of convolution filters applied for the wavelet transform. */
+  std::shared_ptr<const GenericFilterBank<Scalar> > _filterBank;
 };
 
 typedef GenericWaveletTransform<double> WaveletTransform;
@@ -61,36 +250,59 @@ typedef GenericWaveletTransform<double> WaveletTransform;
 }
 
 
+/* ******************************************************************************************** *
+ * Implementation of GenericWaveletTransform::Workspace
+ * ******************************************************************************************** */
+template <class Scalar>
+wt::GenericWaveletTransform<Scalar>::Workspace::Workspace(const GenericWaveletTransform &transform)
+  : _bank(transform._filterBank), _csub(), _rsub(), _threads()
+{
+  // pass...
+}
+
+template <class Scalar>
+typename wt::GenericFilterBank<Scalar>::Workspace &
+wt::GenericWaveletTransform<Scalar>::Workspace::thread(size_t channels) {
+  size_t t = 0;
+#ifdef _OPENMP
+  t = omp_get_thread_num();
+#endif
+  if ((! _threads[t]) || (channels != _threads[t]->channels()))
+    _threads[t].reset(new typename GenericFilterBank<Scalar>::Workspace(*_bank, channels));
+  return *_threads[t];
+}
+
+
 /* ******************************************************************************************** *
  * Implementation of GenericWaveletTransform
  * ******************************************************************************************** */
 template <class Scalar>
-wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const Wavelet &wavelet, const Eigen::Ref<const RVector> &scales, bool subSample)
-  : WaveletAnalysis(wavelet, scales), _subSample(subSample), _filterBank()
+wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &scales, bool subSample, bool analytic, bool causal)
+  : WaveletAnalysis(wavelet, scales), _subSample(subSample), _analytic(analytic), _causal(causal),
+    _groupDelays(), _filterBank()
 {
   this->init_trafo();
 }
 
 template <class Scalar>
-wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, bool subSample)
-  : WaveletAnalysis(wavelet, scales, Nscales), _subSample(subSample), _filterBank()
+wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, bool subSample, bool analytic, bool causal)
+  : WaveletAnalysis(wavelet, scales, Nscales), _subSample(subSample), _analytic(analytic), _causal(causal),
+    _groupDelays(), _filterBank()
 {
   this->init_trafo();
 }
 
 template <class Scalar>
-wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const WaveletAnalysis &other, bool subSample)
-  : WaveletAnalysis(other), _subSample(subSample), _filterBank()
+wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(const WaveletAnalysis &other, bool subSample, bool analytic, bool causal)
+  : WaveletAnalysis(other), _subSample(subSample), _analytic(analytic), _causal(causal),
+    _groupDelays(), _filterBank()
 {
   this->init_trafo();
 }
 
 template <class Scalar>
 wt::GenericWaveletTransform<Scalar>::~GenericWaveletTransform() {
-  // Free filter bank
-  typename std::vector<GenericConvolution<Scalar> *>::iterator filter = _filterBank.begin();
-  for (; filter != _filterBank.end(); filter++)
-    delete *filter;
+  // pass...
 }
 
 template <class Scalar>
@@ -103,10 +315,24 @@ wt::GenericWaveletTransform<Scalar>::init_trafo()
   logDebug() << "Construct wavelet transform for " << _scales.size() << " scales in ["
              << _scales(0) << "," << _scales(_scales.size()-1) << "].";
 
-                // Determine kernel size for every scale and round up to next integer for which the FFT can
+  // Reuse the filter bank of an identical transform if there is one
+  std::string key = this->cacheKey(this->cacheKind());
+  if (! key.empty()) {
+    _filterBank = std::dynamic_pointer_cast<const GenericFilterBank<Scalar> >(
+          FilterBankCache::find(key));
+    if (_filterBank) {
+      _groupDelays = _filterBank->delays();
+      return;
+    }
+  }
+
+  // Determine kernel size for every scale and round up to next integer for which the FFT can
   // be computed fast. Also group the resulting kernels by (rounded) size. This allows to perform
-  // the forward FFT of the signal only once for each group
+  // the forward FFT of the signal only once for each group. Neighbouring scales are merged into
+  // the same group if this is cheaper than a separate group.
   std::list< std::pair<size_t, std::list<double> > > kernelSizes;
+  // Kernel size of the first (smallest) scale of the last group
+  size_t firstSize = 0;
   for (int j=0; j<_scales.size(); j++) {
     // Get the "kernel size" in samples, round up to the next integer for which the
     // convolution can be performed fast.
@@ -115,17 +341,22 @@ wt::GenericWaveletTransform<Scalar>::init_trafo()
       // If first scale -> add new kernel size group
       kernelSizes.push_back(
             std::pair<size_t, std::list<double> >(kernelSize, std::list<double>(1, _scales[j])) );
-    } else if (kernelSizes.back().first == kernelSize) {
-      // If kernel size matches the last group
+      firstSize = kernelSize;
+    } else if (ConvolutionStrategy::merge(firstSize, kernelSizes.back().first,
+                                          kernelSizes.back().second.size(), kernelSize, _analytic)) {
+      // If kernel size matches the last group or merging is cheaper -> use larger kernel size
+      kernelSizes.back().first = kernelSize;
       kernelSizes.back().second.push_back( _scales[j] );
     } else {
-      // If kernel size does not match last group -> add new kernel size group
+      // Otherwise -> add new kernel size group
       kernelSizes.push_back(
             std::pair<size_t, std::list<double> >(kernelSize, std::list<double>(1, _scales[j])) );
+      firstSize = kernelSize;
     }
   }
 
   // Create a block-convolution for each kernel size
+  std::shared_ptr<GenericFilterBank<Scalar> > filterBank(new GenericFilterBank<Scalar>());
   std::list< std::pair<size_t, std::list<double> > >::iterator group = kernelSizes.begin();
   for (; group != kernelSizes.end(); group++) {
     // size of kernels
@@ -142,19 +373,161 @@ wt::GenericWaveletTransform<Scalar>::init_trafo()
     if (!_subSample) { M = 1; }
     // re-evaluate kernel-size (round up to a multiple of sub-sampling)
     N = M * WT_IDIV_CEIL(N,M);
+    // If the Fourier transform of the wavelet is known, sample the spectra of the kernels
+    // directly. This avoids the evaluation of the kernels in the time domain and their FFTs.
+    if (_wavelet.hasSpectrum() && (! _causal)) {
+      GenericConvolution<Scalar> *filters = new GenericConvolution<Scalar>(N/M, K, M, _analytic);
+      CMatrix &spectra = filters->kernelSpectra();
+      // The kernels are centered, i.e. delayed by N/M/2 samples. The normalization of the
+      // backward FFT is folded into the delay.
+      double P = filters->fftSize();
+      CVector delay(spectra.rows());
+      for (int i=0; i<spectra.rows(); i++) {
+        delay(i) = Complex( std::polar(1.0/P, -M_PI*filters->frequency(i)*double(N/M)) );
+      }
+      // Sample spectra of the (sub-sampled) kernels
+      std::list<double>::iterator scale = group->second.begin();
+      for (size_t j=0; scale != group->second.end(); scale++, j++) {
+        for (int i=0; i<spectra.rows(); i++) {
+          spectra(i,j) = delay(i) * Complex(
+                sampledSpectrum(filters->frequency(i), (*scale)/M, double(N/M)/2) / double(M) );
+        }
+      }
+      // The sampled spectra describe periodic kernels, limit them to N/M samples
+      filters->limitKernels();
+      filterBank->add(filters);
+      continue;
+    }
+    // In the causal mode, the sample s of a sub-sampled convolution is interpolated into the
+    // rows [(s-1)M, sM), hence it must not depend on the sub-samples s-1 and s. Prepending 2*lag
+    // zeros to the kernels moves their center by lag and delays them by lag sub-samples.
+    size_t lag = (_causal && (1 < M)) ? 2 : 0;
     // Allocate matrix of filter kernels (each column holds a kernel)
-    CMatrix kernels(N/M, K);
+    CMatrix kernels = CMatrix::Zero(N/M+2*lag, K);
+    Eigen::VectorXd delays = Eigen::VectorXd::Zero(K);
     // Evaluate (subsampled) kernels
     std::list<double>::iterator scale = group->second.begin();
     for (size_t j=0; scale != group->second.end(); scale++, j++) {
       for (size_t i=0; i<N/M; i++) {
-        kernels(i,j) = _wavelet.evalAnalysis( M*(i-double(N/M)/2)/(*scale) ) /
-            ( *scale );
+        kernels(2*lag+i,j) = Complex( _wavelet.evalAnalysis( M*(i-double(N/M)/2)/(*scale) ) /
+                                      ( *scale ) );
       }
+      if (_causal)
+        delays(j) = M*(causalKernel(kernels.col(j).tail(N/M)) + lag);
     }
     // Store filter together with sub-sampling
-    _filterBank.push_back(new GenericConvolution<Scalar>(kernels, M));
+    filterBank->add(new GenericConvolution<Scalar>(kernels, M, _analytic), delays);
   }
+  _groupDelays = filterBank->delays();
+  _filterBank = filterBank;
+  FilterBankCache::insert(key, _filterBank);
+}
+
+/** The version of the binary format of wavelet transforms. */
+#define WT_WAVELETTRANSFORM_VERSION uint32_t(1)
+
+template <class Scalar>
+wt::GenericWaveletTransform<Scalar>::GenericWaveletTransform(std::istream &in)
+  : WaveletAnalysis(Wavelet(), Eigen::VectorXd()), _subSample(false), _analytic(false),
+    _causal(false), _groupDelays(), _filterBank()
+{
+  readBinaryHeader(in, "WTWT", WT_WAVELETTRANSFORM_VERSION);
+  if (sizeof(Scalar) != readBinary<uint32_t>(in)) {
+    IOError err; err << "Can not load wavelet transform of different precision."; throw err;
+  }
+  std::string identifier = readBinaryString(in);
+  try {
+    _wavelet = Wavelet::fromIdentifier(identifier);
+  } catch (ValueError &error) {
+    IOError err; err << "Can not load wavelet transform: " << error.what(); throw err;
+  }
+  _scales.resize(readBinarySize(in, sizeof(double)));
+  readBinary(in, _scales.data(), _scales.size());
+  _subSample = readBinary<uint8_t>(in);
+  _analytic  = readBinary<uint8_t>(in);
+  _causal    = readBinary<uint8_t>(in);
+  std::shared_ptr<GenericFilterBank<Scalar> > filterBank(new GenericFilterBank<Scalar>(in));
+  if (filterBank->numKernels() != size_t(_scales.size())) {
+    IOError err; err << "Can not load wavelet transform: The filter bank holds "
+                     << filterBank->numKernels() << " kernels for " << _scales.size()
+                     << " scales.";
+    throw err;
+  }
+  logDebug() << "Loaded wavelet transform for " << _scales.size() << " scales of wavelet "
+             << identifier << ".";
+  _groupDelays = filterBank->delays();
+  _filterBank = filterBank;
+}
+
+template <class Scalar>
+void
+wt::GenericWaveletTransform<Scalar>::save(std::ostream &out) const {
+  std::string identifier = _wavelet.identifier();
+  if (identifier.empty()) {
+    ValueError err; err << "Can not save wavelet transform: Unknown wavelet."; throw err;
+  }
+  writeBinaryHeader(out, "WTWT", WT_WAVELETTRANSFORM_VERSION);
+  writeBinary(out, uint32_t(sizeof(Scalar)));
+  writeBinary(out, identifier);
+  writeBinary(out, uint64_t(_scales.size()));
+  writeBinary(out, _scales.data(), _scales.size());
+  writeBinary(out, uint8_t(_subSample));
+  writeBinary(out, uint8_t(_analytic));
+  writeBinary(out, uint8_t(_causal));
+  _filterBank->save(out);
+}
+
+template <class Scalar>
+void
+wt::GenericWaveletTransform<Scalar>::save(const std::string &filename) const {
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (! out.is_open()) {
+    IOError err; err << "Can not create file '" << filename << "'."; throw err;
+  }
+  this->save(out);
+}
+
+template <class Scalar>
+wt::GenericWaveletTransform<Scalar>
+wt::GenericWaveletTransform<Scalar>::load(const std::string &filename) {
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if (! in.is_open()) {
+    IOError err; err << "Can not open file '" << filename << "'."; throw err;
+  }
+  return GenericWaveletTransform(in);
+}
+
+template <class Scalar>
+std::string
+wt::GenericWaveletTransform<Scalar>::cacheKind() const {
+  std::ostringstream kind;
+  kind << "transform;" << sizeof(Scalar) << ";" << _subSample << _analytic << _causal;
+  return kind.str();
+}
+
+template <class Scalar>
+double
+wt::GenericWaveletTransform<Scalar>::causalKernel(Eigen::Ref<CVector> kernel)
+{
+  size_t M = kernel.size(), shift = M/2;
+  Scalar norm = kernel.cwiseAbs().sum();
+  // The output at time t is the sum over the kernel samples [shift, M) times the signal samples
+  // (t, t-M+shift], hence truncating the samples [0, shift) removes the lookahead
+  kernel.head(shift).setConstant(0);
+  // Remove the mean by subtracting a multiple of the envelope (like the regularized wavelets)
+  Scalar envelope = kernel.cwiseAbs().sum();
+  if (0 < envelope)
+    kernel -= (kernel.sum()/envelope) * kernel.cwiseAbs().template cast<Complex>();
+  // Restore the norm of the full kernel
+  Scalar truncated = kernel.cwiseAbs().sum();
+  if (0 < truncated)
+    kernel *= norm/truncated;
+  // Group delay, i.e. the center of the energy of the kernel
+  Scalar energy = 0, delay = 0;
+  for (size_t i=shift; i<M; i++) {
+    energy += std::norm(kernel(i)); delay += std::norm(kernel(i))*Scalar(i-shift);
+  }
+  return (0 < energy) ? double(delay/energy) : 0.;
 }
 
 
@@ -163,72 +536,332 @@ template <class iDerived, class oDerived>
 void
 wt::GenericWaveletTransform<Scalar>::operator() (
     const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
-    ProgressDelegateInterface *progress)
-{
-  // signal length
-  int N = signal.size();
-  // Get start indices for each transformation block
-  std::vector<size_t> blockIdxs(_filterBank.size());
-  for (size_t j=0; j<_filterBank.size(); j++) {
-    if (0 == j) {
-      blockIdxs[0] = 0;
-    } else {
-      blockIdxs[j] = blockIdxs[j-1] + _filterBank[j-1]->numKernels();
-    }
-  }
+    ProgressDelegateInterface *progress) const
+{
+  this->decimated(signal, out, 1, progress);
+}
 
-  // Iterate over all convolution filters grouping wavelets with the same size
-  size_t prog = 0;
-  #pragma omp parallel for shared (prog)
-  for (size_t j=0; j<_filterBank.size(); j++)
-  {
-    // Get convolution filters
-    GenericConvolution<Scalar> *filters = _filterBank[j];
-    // Get subsampling
-    int M = filters->subSampling();
-    // Get start column in output matrix
-    size_t outCol = blockIdxs[j];
-    // Get number of kernels in group / # columns in out
-    int K = filters->numKernels();
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletTransform<Scalar>::decimated(
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    size_t decimation, ProgressDelegateInterface *progress) const
+{
+  this->decimated(signal, out, decimation, OUTPUT_COMPLEX, progress);
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletTransform<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    OutputMode output, ProgressDelegateInterface *progress) const
+{
+  this->decimated(signal, out, 1, output, progress);
+}
 
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletTransform<Scalar>::decimated(
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    size_t decimation, OutputMode output, ProgressDelegateInterface *progress) const
+{
+  // Complex outputs receive the complex transform, real ones a real quantity
+  Workspace workspace(*this);
+  (*this)(signal, out, workspace, output, decimation, progress);
+}
+
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletTransform<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    Workspace &workspace, OutputMode output, size_t decimation,
+    ProgressDelegateInterface *progress) const
+{
+  // Complex outputs receive the complex transform, real ones a real quantity
+  assertValue(bool(Eigen::NumTraits<typename oDerived::Scalar>::IsComplex) ==
+              (OUTPUT_COMPLEX == output));
+  assertValue(workspace._bank == _filterBank);
+  this->_transform(signal, out, workspace, decimation, output, progress, 0,
+                   _filterBank->numGroups());
+}
+
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericWaveletTransform<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &signal, GenericMappedMatrix<Scalar> &out,
+    ProgressDelegateInterface *progress) const
+{
+  const GenericFilterBank<Scalar> &filterBank = *_filterBank;
+  size_t Ktot = _scales.size(), C = signal.cols(), nGroups = filterBank.numGroups();
+  // Transform group by group, such that each pass writes a contiguous block of columns of every
+  // channel. These columns are written back and released before the next pass.
+  Workspace workspace(*this);
+  for (size_t j=0; j<nGroups; j++) {
     if (progress)
-      (*progress)(double(prog)/_filterBank.size());
-    prog++;
+      (*progress)(double(j)/nGroups);
+    this->_transform(signal, out.matrix(), workspace, 1, OUTPUT_COMPLEX, 0, j, j+1);
+    for (size_t c=0; c<C; c++)
+      out.release(c*Ktot+filterBank.offset(j), filterBank.group(j).numKernels());
+  }
+}
 
-    if (1 == M) {
-      // w/o sub-sampling -> direct overlap-add convolution
-      filters->apply(signal, out.block(0, outCol, N, K).derived());
-      // continue with next block
-      continue;
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericWaveletTransform<Scalar>::operator() (
+    const Eigen::DenseBase<iDerived> &signal, GenericBlockSink<Scalar> &sink,
+    ProgressDelegateInterface *progress) const
+{
+  this->decimated(signal, sink, 1, progress);
+}
+
+template <class Scalar>
+template <class iDerived>
+void
+wt::GenericWaveletTransform<Scalar>::decimated(
+    const Eigen::DenseBase<iDerived> &signal, GenericBlockSink<Scalar> &sink, size_t decimation,
+    ProgressDelegateInterface *progress) const
+{
+  ptrdiff_t N = signal.rows(), D = std::max(decimation, size_t(1));
+  size_t C = signal.cols(), Ktot = _scales.size();
+  const GenericFilterBank<Scalar> &filterBank = *_filterBank;
+  size_t nGroups = filterBank.numGroups();
+  if ((0 == N) || (0 == C))
+    return;
+
+  Workspace buffers(*this);
+  auto &subsignals = this->_subSignals(signal, buffers, 0, nGroups);
+
+  /*
+   * Split the work into tasks. Every group of wavelets is applied to every batch of (up to 8)
+   * channels and chunks of rows spanning about 4 blocks. The chunks start at multiples of the
+   * sub-sampling and decimation, such that each chunk yields a contiguous block of rows.
+   */
+  struct Task {
+    size_t group, c0, nc;
+    ptrdiff_t r0, r1, s0, s1;
+    double cost;
+  };
+  size_t B = std::min(C, size_t(8));
+  std::vector<Task> tasks;
+  for (size_t j=0; j<nGroups; j++) {
+    const GenericConvolution<Scalar> &filters = filterBank.group(j);
+    bool interpolate = (1 < filters.subSampling());
+    ptrdiff_t S = std::max(filters.subSampling(), size_t(1));
+    size_t n = interpolate ? subsignals[j].rows() : N;
+    ptrdiff_t step = S*D;
+    ptrdiff_t chunk = step*WT_IDIV_CEIL(ptrdiff_t(4*filters.strategy().blockLength())*S, step);
+    for (size_t c0=0; c0<C; c0+=B) {
+      size_t nc = std::min(B, C-c0);
+      for (ptrdiff_t r0=0; r0<N; r0+=chunk) {
+        Task task = { j, c0, nc, r0, std::min(r0+chunk, N), 0, 0, 0 };
+        filters.blockSamples(task.r0, task.r1, N, interpolate, task.s0, task.s1);
+        task.cost = nc*filters.partCost(n, filters.numKernels(), task.s0, task.s1);
+        tasks.push_back(task);
+      }
     }
+  }
+  // Schedule the most expensive tasks first
+  std::stable_sort(tasks.begin(), tasks.end(),
+                   [](const Task &a, const Task &b) { return a.cost > b.cost; });
+  size_t nTasks = tasks.size();
+
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  buffers._threads.resize(nThreads);
+
+  #pragma omp parallel
+  {
+    // Each thread uses its own working memory and output buffer
+    typename GenericFilterBank<Scalar>::Workspace &workspace = buffers.thread(B);
+    CMatrix buffer;
+
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t t=0; t<nTasks; t++)
+    {
+      const Task &task = tasks[t];
+      const GenericConvolution<Scalar> &filters = filterBank.group(task.group);
+      size_t K = filters.numKernels();
+      ptrdiff_t row0 = task.r0/D;
+      buffer.resize(WT_IDIV_CEIL(task.r1, D)-row0, task.nc*K);
+
+      // The tasks are handed out in order, hence the task index reports the progress
+      if (progress)
+        (*progress)(double(t)/nTasks);
+
+      // The channels are K columns apart in the buffer
+      if (1 == filters.subSampling()) {
+        filters.applyBlock(signal.middleCols(task.c0, task.nc), buffer, workspace[task.group],
+                           task.s0, task.s1, row0, N, false, K, D);
+      } else {
+        filters.applyBlock(subsignals[task.group].middleCols(task.c0, task.nc), buffer,
+                           workspace[task.group], task.s0, task.s1, row0, N, true, K, D);
+      }
+      for (size_t c=0; c<task.nc; c++)
+        sink(row0, (task.c0+c)*Ktot+filterBank.offset(task.group), buffer.middleCols(c*K, K));
+    }
+  }
+}
 
-    /*
-     * Perform convolution with sub-sampling
-     */
-    // Number of samples in the sub-sampled signal
-    int n = WT_IDIV_CEIL(N,M);
-    // subsample input signal
-    CVector subsig(n);
-    for (int i=0; i<n; i++) {
+template <class Scalar>
+template <class iDerived>
+std::vector<typename std::conditional<
+    Eigen::NumTraits<typename iDerived::Scalar>::IsComplex,
+    typename wt::Traits<Scalar>::CMatrix, typename wt::Traits<Scalar>::RMatrix>::type> &
+wt::GenericWaveletTransform<Scalar>::_subSignals(
+    const Eigen::DenseBase<iDerived> &signal, Workspace &workspace, size_t g0, size_t g1) const
+{
+  // Real signals are sub-sampled into real matrices, hence the real-to-complex FFT is used
+  typedef std::integral_constant<
+      bool, Eigen::NumTraits<typename iDerived::Scalar>::IsComplex> IsComplex;
+  typedef typename std::conditional<IsComplex::value, CMatrix, RMatrix>::type SubSignal;
+
+  int N = signal.rows(), C = signal.cols();
+  const GenericFilterBank<Scalar> &filterBank = *_filterBank;
+  // The buffers are only reallocated if the size of the signal changed
+  std::vector<SubSignal> &subsignals = workspace.subSignals(IsComplex());
+  subsignals.resize(filterBank.numGroups());
+  for (size_t j=g0; j<g1; j++) {
+    int M = filterBank.group(j).subSampling();
+    if (1 < M)
+      subsignals[j].resize(WT_IDIV_CEIL(N,M), C);
+  }
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t t=0; t<(g1-g0)*C; t++) {
+    size_t j = g0 + t/C; int c = t % C;
+    int M = filterBank.group(j).subSampling(), n = subsignals[j].rows();
+    for (int i=0; (1<M) && (i<n); i++) {
       int mmax = std::min(N-i*M, M);
-      subsig[i] = signal.segment(i*M, mmax).sum();
+      subsignals[j](i,c) = signal.block(i*M, c, mmax, 1)
+          .template cast<typename SubSignal::Scalar>().sum();
     }
+  }
+  return subsignals;
+}
 
-    // Apply overlap-add convolution
-    CMatrix subres(n, K);  // <- Will hold the sub-sampled result
-    filters->apply(subsig, subres.derived());
+template <class Scalar>
+template <class iDerived, class oDerived>
+void
+wt::GenericWaveletTransform<Scalar>::_transform(
+    const Eigen::DenseBase<iDerived> &signal, Eigen::DenseBase<oDerived> &out,
+    Workspace &workspace, size_t decimation, OutputMode output,
+    ProgressDelegateInterface *progress, size_t g0, size_t g1) const
+{
+  // signal length and number of channels
+  int N = signal.rows(), C = signal.cols();
+  // total number of scales
+  size_t Ktot = _scales.size();
+  const GenericFilterBank<Scalar> &filterBank = *_filterBank;
+  size_t nGroups = filterBank.numGroups();
+  if ((0 == N) || (0 == C))
+    return;
+
+  // Sub-sample the signal once for every group using sub-sampling, all tasks of the group
+  // share the sub-sampled signal
+  auto &subsignals = this->_subSignals(signal, workspace, g0, g1);
+
+  /*
+   * Split the work into tasks. Every group of wavelets is applied to every batch of (up to 8)
+   * channels. Expensive groups are further split into ranges of samples and tiles of kernels,
+   * such that the work can be balanced over all threads even if there are only a few groups
+   * and channels.
+   */
+  struct Task {
+    size_t group, c0, nc, k0, nk;
+    ptrdiff_t s0, s1;
+    double cost;
+  };
+  size_t B = std::min(C, 8);
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  // Estimated costs of each group applied to all channels
+  std::vector<double> costs(nGroups);
+  double total = 0;
+  for (size_t j=g0; j<g1; j++) {
+    const GenericConvolution<Scalar> &filters = filterBank.group(j);
+    size_t n = (1 == filters.subSampling()) ? N : subsignals[j].rows();
+    costs[j] = C*filters.partCost(n, filters.numKernels(), 0, n);
+    total += costs[j];
+  }
+  // Aim at about 4 tasks per thread
+  double target = total/(4*nThreads);
+
+  std::vector<Task> tasks;
+  for (size_t j=g0; j<g1; j++) {
+    const GenericConvolution<Scalar> &filters = filterBank.group(j);
+    size_t n = (1 == filters.subSampling()) ? N : subsignals[j].rows();
+    size_t K = filters.numKernels(), L = filters.strategy().blockLength();
+    for (size_t c0=0; c0<size_t(C); c0+=B) {
+      size_t nc = std::min(B, C-c0);
+      size_t pieces = 1;
+      if ((1 < nThreads) && (0 < target))
+        pieces = std::max(size_t(1), size_t(std::ceil(costs[j]*nc/C/target)));
+      // Split into ranges of samples first, each range spans at least 4 blocks to keep the
+      // overhead of the warm-up blocks small, then split the kernels into tiles
+      size_t blocks = WT_IDIV_CEIL(n, L);
+      size_t nRanges = std::max(size_t(1), std::min(pieces, blocks/4));
+      size_t nTiles = std::min(K, WT_IDIV_CEIL(pieces, nRanges));
+      size_t tile = WT_IDIV_CEIL(K, nTiles);
+      for (size_t r=0; r<nRanges; r++) {
+        ptrdiff_t s0 = (r*blocks/nRanges)*L;
+        ptrdiff_t s1 = ((r+1) == nRanges) ? n : ((r+1)*blocks/nRanges)*L;
+        for (size_t k0=0; k0<K; k0+=tile) {
+          size_t nk = std::min(tile, K-k0);
+          tasks.push_back(Task{j, c0, nc, k0, nk, s0, s1,
+                               nc*filters.partCost(n, nk, s0, s1)});
+        }
+      }
+    }
+  }
+  // Schedule the most expensive tasks first
+  std::stable_sort(tasks.begin(), tasks.end(),
+                   [](const Task &a, const Task &b) { return a.cost > b.cost; });
+  size_t nTasks = tasks.size();
 
-    // Interpolate results into output buffer
-    for (int i=0; i<n; i++) {
-      int mmax = std::min(N-i*M, M);
-      // For every shift within the M-fold sub-sampling:
-      for (int m=0; m<mmax; m++) {
-        out.block(i*M+m, outCol, 1, K) = (subres.row(i)*(M-m))/M;
-        if ((i+1)<n) { out.block(i*M+m, outCol, 1, K) += (subres.row(i+1)*m)/M; }
+  if (workspace._threads.size() < size_t(nThreads))
+    workspace._threads.resize(nThreads);
+
+  #pragma omp parallel
+  {
+    // Each thread uses its own working memory, the kernel spectra are shared
+    typename GenericFilterBank<Scalar>::Workspace &groups = workspace.thread(B);
+
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t t=0; t<nTasks; t++)
+    {
+      const Task &task = tasks[t];
+      // Get convolution filters
+      const GenericConvolution<Scalar> &filters = filterBank.group(task.group);
+      // Get start column in output matrix, the channels are Ktot columns apart
+      size_t outCol = task.c0*Ktot + filterBank.offset(task.group);
+      auto outBlock = out.block(0, outCol, out.rows(), out.cols()-outCol);
+      typename GenericConvolution<Scalar>::Workspace &ws = groups.get(task.group, task.nk);
+
+      // The tasks are handed out in order, hence the task index reports the progress
+      if (progress)
+        (*progress)(double(t)/nTasks);
+
+      if (1 == filters.subSampling()) {
+        // w/o sub-sampling -> direct block convolution
+        filters.applyPart(signal.middleCols(task.c0, task.nc), outBlock, ws,
+                          task.k0, task.s0, task.s1, false, Ktot, decimation, output);
+      } else {
+        // Apply convolution to the sub-sampled signal and interpolate the results directly
+        // into the output buffer
+        filters.applyPart(subsignals[task.group].middleCols(task.c0, task.nc), outBlock, ws,
+                          task.k0, task.s0, task.s1, true, Ktot, decimation, output);
       }
     }
   }
 }
 
-
 #endif // __WAVELETTRANSFORM_HH__
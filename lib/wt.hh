@@ -50,8 +50,13 @@
 #include "config.hh"
 #include "exception.hh"
 #include "types.hh"
+#include "mappedmatrix.hh"
+#include "blocksink.hh"
 #include "api.hh"
+#include "filterbankcache.hh"
 #include "wavelettransform.hh"
+#include "streamingwavelettransform.hh"
+#include "spectralwavelettransform.hh"
 #include "waveletsynthesis.hh"
 #include "waveletconvolution.hh"
 
@@ -1,4 +1,5 @@
 import unittest
+import pickle
 from numpy import *
 import wt
 
@@ -22,6 +23,18 @@ class TestWaveletTransform(unittest.TestCase):
 
     self.assertTrue(allclose(transformed[:,0], wavelet, atol=1e-5))
 
+  def test_pickle(self):
+    # A pickled transform carries its filter bank and yields the same result
+    N = 1024;
+    scales = linspace(4, 100, 16)
+    signal = random.randn(N)
+    WT = wt.WaveletTransform(wt.Morlet(), scales, True, True);
+    copy = pickle.loads(pickle.dumps(WT))
+    expected = empty((N, 16), dtype=complex); result = empty((N, 16), dtype=complex)
+    WT.transformReal(signal, expected)
+    copy.transformReal(signal, result)
+    self.assertTrue(allclose(result, expected, atol=1e-12))
+
 
 class TestWaveletSynthesis(unittest.TestCase):
   """ Implements some simple tests for the wavelet synthesis. """
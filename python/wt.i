@@ -1,5 +1,6 @@
 %module wt
 %include "std_complex.i"
+%include "std_string.i"
 
 %{
 #include "wt.hh"
@@ -37,6 +38,14 @@ public:
   double cutOffTime() const;
   %feature("autodoc", "Returns the width of the unscaled (mother) wavelet in the frequency domain.");
   double cutOffFreq() const;
+  %feature("autodoc", "Returns true if the Fourier transform of the wavelet is known.");
+  bool hasSpectrum() const;
+  %feature("autodoc", "Evaluates the Fourier transform of the unscaled analysis mother wavelet.");
+  std::complex<double> evalAnalysisSpectrum(double f);
+  %feature("autodoc", "Evaluates the Fourier transform of the unscaled synthesis mother wavelet.");
+  std::complex<double> evalSynthesisSpectrum(double f);
+  %feature("autodoc", "Returns a string identifying the type and parameters of the wavelet.");
+  std::string identifier() const;
 };
 
 
@@ -144,19 +153,54 @@ public:
 %numpy_typemaps(std::complex<double> , NPY_CDOUBLE, int)
 %apply (double* IN_ARRAY1, int DIM1) {(double* scales, int Nscales)};
 %apply (std::complex<double>* IN_ARRAY1, int DIM1) {(std::complex<double>* signal, int Nsig)};
+%apply (double* IN_ARRAY1, int DIM1) {(double* rsignal, int Nsig)};
+%apply (double* OUT_ARRAY1, int DIM1) {(double* outDelays, int Nscales)};
+%apply (std::complex<double>* IN_FARRAY2, int DIM1, int DIM2) {(std::complex<double>* signals, int Nsig, int Nchan)};
+%apply (double* IN_FARRAY2, int DIM1, int DIM2) {(double* rsignals, int Nsig, int Nchan)};
 %apply (std::complex<double>* INPLACE_FARRAY2, int DIM1, int DIM2) {(std::complex<double>* out, int Nrow, int Ncol)};
+%apply (double* INPLACE_FARRAY2, int DIM1, int DIM2) {(double* rout, int Nrow, int Ncol)};
 
 namespace wt {
+typedef enum {
+  OUTPUT_COMPLEX, OUTPUT_MODULUS, OUTPUT_POWER, OUTPUT_LOG_POWER, OUTPUT_PHASE
+} OutputMode;
+
 %feature("autodoc", "Implements the continous wavelet transform.");
 class WaveletTransform: public WaveletAnalysis
 {
 public:
-  WaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, bool subSample=false);
+  WaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, bool subSample=false,
+                   bool analytic=false, bool causal=false);
+  %feature("autodoc", "Copy constructor, the copy shares the filter bank.");
+  WaveletTransform(const WaveletTransform &other);
+  bool causal() const;
   virtual ~WaveletTransform();
 };
 }
 
+%newobject wt::WaveletTransform::load;
+%newobject wt::WaveletTransform::_load_state;
+%define WT_CHECK_PYERR(method)
+%exception method {
+  $action
+  if (PyErr_Occurred()) SWIG_fail;
+}
+%enddef
+WT_CHECK_PYERR(wt::WaveletTransform::save)
+WT_CHECK_PYERR(wt::WaveletTransform::load)
+WT_CHECK_PYERR(wt::WaveletTransform::_load_state)
+
 %extend wt::WaveletTransform {
+%feature("autodoc", "Returns the group delay (in samples) of every scale.");
+void groupDelays(double *outDelays, int Nscales) const {
+  if (Nscales != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales does not match!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXd>(outDelays, Nscales) = self->groupDelays();
+}
+
 void operator() (std::complex<double> *signal, int Nsig, std::complex<double> *out, int Nrow, int Ncol) {
   if (Nsig != Nrow) {
     PyErr_Format(PyExc_ValueError,
@@ -172,6 +216,209 @@ void operator() (std::complex<double> *signal, int Nsig, std::complex<double> *o
   Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
   (*self)(signalMap, outMap);
 }
+
+%feature("autodoc", "Transforms a real valued signal using real-to-complex FFTs.");
+void transformReal(double *rsignal, int Nsig, std::complex<double> *out, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXd> signalMap(rsignal, Nsig);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
+  (*self)(signalMap, outMap);
+}
+
+%feature("autodoc", "Transforms a signal but stores only every decimation-th row of the result. The output must have ceil(N/decimation) rows.");
+void transformDecimated(std::complex<double> *signal, int Nsig, int decimation,
+                        std::complex<double> *out, int Nrow, int Ncol) {
+  if ((decimation < 1) || (WT_IDIV_CEIL(Nsig, decimation) != Nrow)) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length, decimation and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXcd> signalMap(signal, Nsig);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nrow, Ncol);
+  self->decimated(signalMap, outMap, decimation);
+}
+
+%feature("autodoc", "Transforms a signal and stores only a real quantity of the result (OUTPUT_MODULUS, OUTPUT_POWER, OUTPUT_LOG_POWER or OUTPUT_PHASE) into the real output.");
+void transformOutput(std::complex<double> *signal, int Nsig, wt::OutputMode output,
+                     double *rout, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales and output columns do not match!");
+    return;
+  }
+  if (wt::OUTPUT_COMPLEX == output) {
+    PyErr_Format(PyExc_ValueError,
+                 "The complex output can not be stored into a real array!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXcd> signalMap(signal, Nsig);
+  Eigen::Map<Eigen::MatrixXd> outMap(rout, Nsig, Ncol);
+  (*self)(signalMap, outMap, output);
+}
+
+%feature("autodoc", "Transforms the channels (columns) of a signal at once. The transform of the c-th channel is stored in the columns [c*K, (c+1)*K) of the output.");
+void transformChannels(std::complex<double> *signals, int Nsig, int Nchan,
+                       std::complex<double> *out, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())*Nchan) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales times channels and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::MatrixXcd> signalMap(signals, Nsig, Nchan);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
+  (*self)(signalMap, outMap);
+}
+
+%feature("autodoc", "Transforms the real valued channels (columns) of a signal at once.");
+void transformRealChannels(double *rsignals, int Nsig, int Nchan,
+                           std::complex<double> *out, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())*Nchan) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales times channels and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::MatrixXd> signalMap(rsignals, Nsig, Nchan);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
+  (*self)(signalMap, outMap);
+}
+
+%feature("autodoc", "Saves the transform together with its filter bank to the given file.");
+void save(const char *filename) const {
+  try {
+    self->save(std::string(filename));
+  } catch (wt::Error &err) {
+    PyErr_SetString(PyExc_IOError, err.what());
+  }
+}
+
+%feature("autodoc", "Loads a transform saved by save() from the given file, skipping the construction of its filter bank.");
+static wt::WaveletTransform *load(const char *filename) {
+  try {
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (! in.is_open()) {
+      PyErr_Format(PyExc_IOError, "Can not open file '%s'.", filename);
+      return 0;
+    }
+    return new wt::WaveletTransform(in);
+  } catch (wt::Error &err) {
+    PyErr_SetString(PyExc_IOError, err.what());
+  }
+  return 0;
+}
+
+PyObject *_save_state() const {
+  std::ostringstream buffer;
+  try {
+    self->save(buffer);
+  } catch (wt::Error &err) {
+    PyErr_SetString(PyExc_ValueError, err.what());
+    return 0;
+  }
+  std::string state = buffer.str();
+  return PyBytes_FromStringAndSize(state.data(), state.size());
+}
+
+static wt::WaveletTransform *_load_state(PyObject *state) {
+  char *data; Py_ssize_t size;
+  if (0 != PyBytes_AsStringAndSize(state, &data, &size))
+    return 0;
+  try {
+    std::istringstream buffer(std::string(data, size));
+    return new wt::WaveletTransform(buffer);
+  } catch (wt::Error &err) {
+    PyErr_SetString(PyExc_IOError, err.what());
+  }
+  return 0;
+}
+
+%pythoncode %{
+def __getstate__(self):
+  """Returns the transform together with its filter bank as bytes, hence workers (e.g., of
+  multiprocessing) receive a ready transform."""
+  return self._save_state()
+
+def __setstate__(self, state):
+  """Restores the transform from the state returned by __getstate__."""
+  self.__init__(WaveletTransform._load_state(state))
+%}
+}
+
+
+/*
+ * Interfacing SpectralWaveletTransform class
+ */
+namespace wt {
+%feature("autodoc", "Implements the continous wavelet transform using a single FFT of the signal.");
+class SpectralWaveletTransform: public WaveletAnalysis
+{
+public:
+  SpectralWaveletTransform(const Wavelet &wavelet, double *scales, int Nscales, size_t batchSize=16);
+  virtual ~SpectralWaveletTransform();
+};
+}
+
+%extend wt::SpectralWaveletTransform {
+void operator() (std::complex<double> *signal, int Nsig, std::complex<double> *out, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXcd> signalMap(signal, Nsig);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
+  (*self)(signalMap, outMap);
+}
+
+%feature("autodoc", "Transforms a real valued signal using a real-to-complex FFT.");
+void transformReal(double *rsignal, int Nsig, std::complex<double> *out, int Nrow, int Ncol) {
+  if (Nsig != Nrow) {
+    PyErr_Format(PyExc_ValueError,
+                 "Signal length and output rows do not match!");
+    return;
+  }
+  if (Ncol != int(self->nScales())) {
+    PyErr_Format(PyExc_ValueError,
+                 "Number of scales and output columns do not match!");
+    return;
+  }
+  Eigen::Map<Eigen::VectorXd> signalMap(rsignal, Nsig);
+  Eigen::Map<Eigen::MatrixXcd> outMap(out, Nsig, Ncol);
+  (*self)(signalMap, outMap);
+}
 }
 
 
@@ -222,9 +469,16 @@ namespace wt {
 class WaveletConvolution: public WaveletAnalysis
 {
 public:
-  WaveletConvolution(const Wavelet &wavelet, double *scales, int Nscales);
-  WaveletConvolution(const WaveletAnalysis &wt);
+  typedef enum {
+    DIRECT, SYNTHESIS
+  } Algorithm;
+
+public:
+  WaveletConvolution(const Wavelet &wavelet, double *scales, int Nscales,
+                     Algorithm algorithm=DIRECT);
+  WaveletConvolution(const WaveletAnalysis &wt, Algorithm algorithm=DIRECT);
   virtual ~WaveletConvolution();
+  Algorithm algorithm() const;
 };
 }
 
@@ -269,5 +523,38 @@ namespace wt {
     Eigen::Map<Eigen::VectorXd> outMap(out, N);
     wt::decadic_range(a,b,outMap);
   }
+
+  bool prefer_spectral_transform(const Wavelet &wavelet, double *scales, int Nscales, int N) {
+    Eigen::Map<Eigen::VectorXd> scalesMap(scales, Nscales);
+    return wt::preferSpectralTransform(wavelet, scalesMap, N);
+  }
+
+  bool import_fft_wisdom(const char *filename) {
+    return wt::FFTPlanRegistry<double>::importWisdom(filename);
+  }
+
+  bool export_fft_wisdom(const char *filename) {
+    return wt::FFTPlanRegistry<double>::exportWisdom(filename);
+  }
+
+  size_t filter_bank_cache_capacity() {
+    return wt::FilterBankCache::capacity();
+  }
+
+  void set_filter_bank_cache_capacity(size_t bytes) {
+    wt::FilterBankCache::setCapacity(bytes);
+  }
+
+  size_t filter_bank_cache_size() {
+    return wt::FilterBankCache::size();
+  }
+
+  size_t filter_bank_cache_memory() {
+    return wt::FilterBankCache::memory();
+  }
+
+  void clear_filter_bank_cache() {
+    wt::FilterBankCache::clear();
+  }
   }
 %}
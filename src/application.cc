@@ -2,7 +2,11 @@
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
 #include "api.hh"
+#include "fft.hh"
 #include "utils/csv.hh"
 #include "utils/logger.hh"
 #include <fstream>
@@ -28,10 +32,18 @@ Application::Application(int &argc, char **argv)
   connect(&_procStat, SIGNAL(updated(double,double,double)),
           this, SIGNAL(procStats(double,double,double)));
   _procStatTimer.start();
+
+  // Load FFTW wisdom of previous sessions
+  QDir dataDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+  _wisdomFile = dataDir.absoluteFilePath("fftw-wisdom");
+  if (QFile::exists(_wisdomFile))
+    wt::FFTPlanRegistry<double>::importWisdom(_wisdomFile.toStdString());
 }
 
 Application::~Application() {
-  // pass...
+  // Store FFTW wisdom for the next session
+  QDir().mkpath(QFileInfo(_wisdomFile).absolutePath());
+  wt::FFTPlanRegistry<double>::exportWisdom(_wisdomFile.toStdString());
 }
 
 bool
@@ -53,6 +53,7 @@ protected:
   ItemModel *_items;
   QTimer _procStatTimer;
   ProcInfo _procStat;
+  QString _wisdomFile;
 };
 
 #endif // APPLICATION_HH
@@ -7,11 +7,12 @@
 /* ******************************************************************************************** *
  * Implementation of TransformTask
  * ******************************************************************************************** */
-TransformTask::TransformTask(wt::Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXcd> &timeseries,
+TransformTask::TransformTask(wt::Wavelet &wavelet, const Eigen::Ref<const Eigen::VectorXd> &rtimeseries,
+    const Eigen::Ref<const Eigen::VectorXcd> &timeseries,
     const Eigen::Ref<const Eigen::VectorXd> &scales, Eigen::Ref<Eigen::MatrixXcd> result,
     QObject *parent)
-  : QThread(parent), _wavelet(wavelet), _timeseries(timeseries), _scales(scales), _result(result),
-    _trafo(0)
+  : QThread(parent), _wavelet(wavelet), _rtimeseries(rtimeseries), _timeseries(timeseries),
+    _scales(scales), _result(result), _trafo(0)
 {
   // pass...
 }
@@ -26,7 +27,11 @@ TransformTask::run() {
   logDebug() << "Start wavelet transform...";
   _trafo = new wt::WaveletTransform(_wavelet, _scales);
   wt::ProgressDelegate<TransformTask> delegate(*this, &TransformTask::progresscb);
-  (*_trafo)(_timeseries, _result, &delegate);
+  // Real time series are transformed using the real-to-complex FFT
+  if (_rtimeseries.size())
+    (*_trafo)(_rtimeseries, _result, &delegate);
+  else
+    (*_trafo)(_timeseries, _result, &delegate);
   logDebug() << "  ... done.";
 }
 
@@ -42,17 +47,19 @@ TransformTask::progresscb(double frac) {
 TransformItem::TransformItem(TimeseriesItem *timeseries, wt::Wavelet &wavelet,
                              const Eigen::Ref<const Eigen::VectorXd> &scales,
                              TransformedItem::Scaling scaling, const QString &label, QObject *parent)
-  : Item(label, parent), _timeseries(timeseries->size()), _scales(scales), _scaling(scaling),
-    _result(_timeseries.size(), scales.size()), _wavelet(wavelet),
-    _task(_wavelet, _timeseries, _scales, _result),
+  : Item(label, parent),
+    _rtimeseries(dynamic_cast<RealTimeseriesItem *>(timeseries) ? timeseries->size() : 0),
+    _timeseries(dynamic_cast<ComplexTimeseriesItem *>(timeseries) ? timeseries->size() : 0),
+    _scales(scales), _scaling(scaling), _result(timeseries->size(), scales.size()),
+    _wavelet(wavelet), _task(_wavelet, _rtimeseries, _timeseries, _scales, _result),
     _Fs(timeseries->Fs()), _t0(timeseries->t0())
 {
   _icon  = QIcon("://icons/task16.png");
 
-  // copy TS values
+  // copy TS values, real time series are kept real
   if (RealTimeseriesItem *ritem = dynamic_cast<RealTimeseriesItem *>(timeseries)) {
-    for (int i=0; i<_timeseries.size(); i++) {
-      _timeseries(i) = ritem->data()(i);
+    for (int i=0; i<_rtimeseries.size(); i++) {
+      _rtimeseries(i) = ritem->data()(i);
     }
   } else if (ComplexTimeseriesItem *citem = dynamic_cast<ComplexTimeseriesItem *>(timeseries)) {
     for (int i=0; i<_timeseries.size(); i++) {
@@ -17,6 +17,7 @@ class TransformTask: public QThread
 
 public:
   TransformTask(wt::Wavelet &wavelet,
+                const Eigen::Ref<const Eigen::VectorXd> &rtimeseries,
                 const Eigen::Ref<const Eigen::VectorXcd> &timeseries,
                 const Eigen::Ref<const Eigen::VectorXd> &scales,
                 Eigen::Ref<Eigen::MatrixXcd> result,
@@ -33,6 +34,7 @@ protected:
 
 protected:
   wt::Wavelet &_wavelet;
+  Eigen::Ref<const Eigen::VectorXd> _rtimeseries;
   Eigen::Ref<const Eigen::VectorXcd> _timeseries;
   Eigen::Ref<const Eigen::VectorXd> _scales;
   Eigen::Ref<Eigen::MatrixXcd> _result;
@@ -75,6 +77,7 @@ protected slots:
   void onTaskFinished();
 
 protected:
+  Eigen::VectorXd _rtimeseries;
   Eigen::VectorXcd _timeseries;
   Eigen::VectorXd _scales;
   TransformedItem::Scaling _scaling;
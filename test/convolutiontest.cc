@@ -52,6 +52,246 @@ ConvolutionTest::testShortSignal() {
   }
 }
 
+void
+ConvolutionTest::testReal() {
+  // A real signal must give the same result as the same signal passed as a complex one
+  Eigen::VectorXd in(100);
+  for (size_t i=0; i<100; i++) { in(i) = std::sin(2*M_PI*i/8) + std::cos(2*M_PI*i*i/200); }
+  Eigen::VectorXcd cin = in.cast< std::complex<double> >();
+  Eigen::MatrixXcd kernel = Eigen::MatrixXcd::Random(8,3);
+
+  GenericConvolution<double> conv(kernel);
+  Eigen::MatrixXcd out = Eigen::MatrixXcd::Zero(100,3);
+  Eigen::MatrixXcd ref = Eigen::MatrixXcd::Zero(100,3);
+  conv.apply(in, out);
+  conv.apply(cin, ref);
+
+  for (size_t i=0; i<100; i++) {
+    for (size_t j=0; j<3; j++) {
+      UT_ASSERT_NEAR_EPS(out(i,j).real(), ref(i,j).real(), 1e-8);
+      UT_ASSERT_NEAR_EPS(out(i,j).imag(), ref(i,j).imag(), 1e-8);
+    }
+  }
+}
+
+void
+ConvolutionTest::testAnalytic() {
+  // The kernel is a complex Gabor atom with (practically) vanishing negative frequencies, hence
+  // the analytic convolution must give the same result as the full one.
+  Eigen::VectorXd in(200);
+  for (size_t i=0; i<200; i++) { in(i) = std::sin(2*M_PI*i/8) + std::cos(2*M_PI*i*i/400); }
+  Eigen::VectorXcd kernel(64);
+  for (size_t i=0; i<64; i++) {
+    double t = double(i)-32;
+    kernel(i) = std::exp(-t*t/64) * std::exp(std::complex<double>(0, M_PI*t/2));
+  }
+
+  GenericConvolution<double> conv(kernel), aconv(kernel, 1, true);
+  UT_ASSERT(aconv.analytic());
+  Eigen::VectorXcd out = Eigen::VectorXcd::Zero(200);
+  Eigen::VectorXcd aout = Eigen::VectorXcd::Zero(200);
+  conv.apply(in, out);
+  aconv.apply(in, aout);
+
+  for (size_t i=0; i<200; i++) {
+    UT_ASSERT_NEAR_EPS(aout(i).real(), out(i).real(), 1e-6);
+    UT_ASSERT_NEAR_EPS(aout(i).imag(), out(i).imag(), 1e-6);
+  }
+}
+
+void
+ConvolutionTest::testOddKernel() {
+  // Compare with the direct convolution, out(t) = sum_k kernel(k) in(t+M/2-k)
+  Eigen::VectorXcd in(100);
+  for (size_t i=0; i<100; i++) { in(i) = std::sin(2*M_PI*i/8) + std::cos(2*M_PI*i*i/200); }
+  Eigen::MatrixXcd kernel = Eigen::MatrixXcd::Random(7,2);
+  Eigen::MatrixXcd ref = Eigen::MatrixXcd::Zero(100,2);
+  for (int t=0; t<100; t++) {
+    for (int k=0; k<7; k++) {
+      if (((t+3-k) >= 0) && ((t+3-k) < 100))
+        ref.row(t) += kernel.row(k)*in(t+3-k);
+    }
+  }
+
+  GenericConvolution<double> conv(kernel);
+  Eigen::MatrixXcd out = Eigen::MatrixXcd::Zero(100,2);
+  conv.apply(in, out);
+
+  for (size_t i=0; i<100; i++) {
+    for (size_t j=0; j<2; j++) {
+      UT_ASSERT_NEAR_EPS(out(i,j).real(), ref(i,j).real(), 1e-8);
+      UT_ASSERT_NEAR_EPS(out(i,j).imag(), ref(i,j).imag(), 1e-8);
+    }
+  }
+}
+
+void
+ConvolutionTest::testAlgorithms() {
+  // Overlap-add, overlap-save and the whole-signal FFT must give the same results
+  Eigen::VectorXcd in(300);
+  for (size_t i=0; i<300; i++) { in(i) = std::sin(2*M_PI*i/8) + std::cos(2*M_PI*i*i/600); }
+  Eigen::MatrixXcd kernel = Eigen::MatrixXcd::Random(16,2);
+
+  GenericConvolution<double> ola(kernel, 1, false, ConvolutionStrategy::OVERLAP_ADD);
+  GenericConvolution<double> ols(kernel, 1, false, ConvolutionStrategy::OVERLAP_SAVE);
+  GenericConvolution<double> single(kernel, 1, false, ConvolutionStrategy::AUTO, 300);
+  UT_ASSERT(ConvolutionStrategy::OVERLAP_ADD == ola.strategy().algorithm());
+  UT_ASSERT(ConvolutionStrategy::OVERLAP_SAVE == ols.strategy().algorithm());
+  UT_ASSERT(ConvolutionStrategy::OVERLAP_SAVE == single.strategy().algorithm());
+  UT_ASSERT(ols.strategy().blockLength() < 300);
+
+  Eigen::MatrixXcd outA(300,2), outS(300,2), outF(300,2);
+  ola.apply(in, outA); ols.apply(in, outS); single.apply(in, outF);
+  for (size_t i=0; i<300; i++) {
+    for (size_t j=0; j<2; j++) {
+      UT_ASSERT_NEAR_EPS(outA(i,j).real(), outS(i,j).real(), 1e-8);
+      UT_ASSERT_NEAR_EPS(outA(i,j).imag(), outS(i,j).imag(), 1e-8);
+      UT_ASSERT_NEAR_EPS(outF(i,j).real(), outS(i,j).real(), 1e-8);
+      UT_ASSERT_NEAR_EPS(outF(i,j).imag(), outS(i,j).imag(), 1e-8);
+    }
+  }
+
+  // A signal shorter than the kernels is convolved using a single FFT
+  ConvolutionStrategy strategy(200, 4, 50);
+  UT_ASSERT(strategy.blockLength() >= 50);
+  UT_ASSERT(strategy.fftSize() < 400);
+}
+
+void
+ConvolutionTest::testSIMD() {
+  // All supported instruction sets must give the result of the portable implementation, also
+  // for lengths that are not a multiple of the vector size and in-place
+  SIMDLevel best = supportedSIMDLevel();
+  size_t n = 1029, K = 3;
+  Eigen::VectorXcd part = Eigen::VectorXcd::Random(n);
+  Eigen::MatrixXcd kernels = Eigen::MatrixXcd::Random(n+3, K);
+  Eigen::MatrixXcd ref = part.asDiagonal() * kernels.topRows(n);
+  Eigen::VectorXcf partf = part.cast< std::complex<float> >();
+  Eigen::MatrixXcf kernelsf = kernels.cast< std::complex<float> >();
+  for (int level=SIMD_GENERIC; level<=int(best); level++) {
+    UT_ASSERT(SIMDLevel(level) == setSIMDLevel(SIMDLevel(level)));
+    Eigen::MatrixXcd out(n, K);
+    spectrumMultiply(part.data(), kernels.data(), n+3, out.data(), n, n, K);
+    UT_ASSERT((out-ref).cwiseAbs().maxCoeff() < 1e-12);
+    Eigen::MatrixXcd inplace = kernels;
+    spectrumMultiply(part.data(), inplace.data(), n+3, inplace.data(), n+3, n, K);
+    UT_ASSERT((inplace.topRows(n)-ref).cwiseAbs().maxCoeff() < 1e-12);
+    Eigen::MatrixXcf outf(n, K);
+    spectrumMultiply(partf.data(), kernelsf.data(), n+3, outf.data(), n, n, K);
+    UT_ASSERT((outf.cast< std::complex<double> >()-ref).cwiseAbs().maxCoeff() < 1e-5);
+  }
+  setSIMDLevel(best);
+}
+
+void
+ConvolutionTest::testInterpolated() {
+  // The interpolating epilogue must match the convolution followed by a linear interpolation,
+  // for both block algorithms and an output shorter than n*M rows
+  size_t n = 101, M = 3, N = n*M-2;
+  Eigen::VectorXd in(n);
+  for (size_t i=0; i<n; i++) { in(i) = std::sin(2*M_PI*i/16) + std::cos(2*M_PI*i*i/300); }
+  Eigen::MatrixXcd kernel = Eigen::MatrixXcd::Random(16,2);
+  ConvolutionStrategy::Algorithm algs[2] = {
+    ConvolutionStrategy::OVERLAP_ADD, ConvolutionStrategy::OVERLAP_SAVE };
+  for (size_t a=0; a<2; a++) {
+    GenericConvolution<double> conv(kernel, M, false, algs[a]);
+    Eigen::MatrixXcd sub(n, 2), out(N, 2);
+    conv.apply(in, sub);
+    conv.applyInterpolated(in, out);
+    for (size_t i=0; i<N; i++) {
+      size_t k = i/M, m = i%M;
+      for (size_t j=0; j<2; j++) {
+        std::complex<double> ref = sub(k,j)*double(M-m)/double(M);
+        if ((k+1) < n)
+          ref += sub(k+1,j)*double(m)/double(M);
+        UT_ASSERT_NEAR_EPS(out(i,j).real(), ref.real(), 1e-10);
+        UT_ASSERT_NEAR_EPS(out(i,j).imag(), ref.imag(), 1e-10);
+      }
+    }
+  }
+}
+
+void
+ConvolutionTest::testParts() {
+  // Applying tiles of kernels to ranges of samples must yield the complete convolution
+  size_t n = 301, M = 3, N = n*M-2;
+  Eigen::VectorXd in(n);
+  for (size_t i=0; i<n; i++) { in(i) = std::sin(2*M_PI*i/16) + std::cos(2*M_PI*i*i/300); }
+  Eigen::MatrixXcd kernel = Eigen::MatrixXcd::Random(17,3);
+  ptrdiff_t ranges[4] = {0, 37, 150, ptrdiff_t(n)};
+  ConvolutionStrategy::Algorithm algs[2] = {
+    ConvolutionStrategy::OVERLAP_ADD, ConvolutionStrategy::OVERLAP_SAVE };
+  for (size_t a=0; a<2; a++) {
+    GenericConvolution<double> conv(kernel, M, false, algs[a]);
+    GenericConvolution<double>::Workspace ws(conv, 1, 2);
+    Eigen::MatrixXcd ref(n, 3), out(n, 3), iref(N, 3), iout(N, 3);
+    conv.apply(in, ref);
+    conv.applyInterpolated(in, iref);
+    for (size_t r=0; r<3; r++) {
+      for (size_t k0=0; k0<3; k0+=2) {
+        GenericConvolution<double>::Workspace tail(conv, 1, 1);
+        GenericConvolution<double>::Workspace &w = (0 == k0) ? ws : tail;
+        conv.applyPart(in, out, w, k0, ranges[r], ranges[r+1], false);
+        conv.applyPart(in, iout, w, k0, ranges[r], ranges[r+1], true);
+      }
+    }
+    UT_ASSERT_NEAR_EPS((out-ref).cwiseAbs().maxCoeff(), 0.0, 1e-10);
+    UT_ASSERT_NEAR_EPS((iout-iref).cwiseAbs().maxCoeff(), 0.0, 1e-10);
+
+    // Blocks of rows stored into buffers holding only these rows
+    GenericConvolution<double>::Workspace full(conv);
+    ptrdiff_t irows[4] = {0, 111, 450, ptrdiff_t(N)};
+    for (size_t r=0; r<3; r++) {
+      ptrdiff_t s0, s1;
+      Eigen::MatrixXcd block(ranges[r+1]-ranges[r], 3), iblock(irows[r+1]-irows[r], 3);
+      conv.blockSamples(ranges[r], ranges[r+1], n, false, s0, s1);
+      conv.applyBlock(in, block, full, s0, s1, ranges[r], n, false);
+      UT_ASSERT_NEAR_EPS((block-ref.middleRows(ranges[r], block.rows())).cwiseAbs().maxCoeff(),
+                         0.0, 1e-10);
+      conv.blockSamples(irows[r], irows[r+1], N, true, s0, s1);
+      conv.applyBlock(in, iblock, full, s0, s1, irows[r], N, true);
+      UT_ASSERT_NEAR_EPS((iblock-iref.middleRows(irows[r], iblock.rows())).cwiseAbs().maxCoeff(),
+                         0.0, 1e-10);
+    }
+  }
+}
+
+void
+ConvolutionTest::testSummed() {
+  // The convolution summed over several inputs must equal the sum of the separate convolutions
+  size_t n = 300, G = 3, K = 2;
+  Eigen::MatrixXd in(n, 2*G);
+  for (size_t i=0; i<n; i++) {
+    for (size_t g=0; g<2*G; g++)
+      in(i,g) = std::sin(2*M_PI*i*(g+1)/64) + std::cos(2*M_PI*i*i/(300+g));
+  }
+  Eigen::MatrixXcd kernels = Eigen::MatrixXcd::Random(17, G*K);
+  ConvolutionStrategy::Algorithm algs[2] = {
+    ConvolutionStrategy::OVERLAP_ADD, ConvolutionStrategy::OVERLAP_SAVE };
+  for (size_t a=0; a<2; a++) {
+    GenericConvolution<double> summed(kernels, 1, false, algs[a], 0, G);
+    UT_ASSERT_EQUAL(summed.numKernels(), K);
+    UT_ASSERT_EQUAL(summed.numInputs(), G);
+    // Two channels of G inputs each
+    Eigen::MatrixXcd ref = Eigen::MatrixXcd::Zero(n, 2*K), out(n, 2*K);
+    for (size_t c=0; c<2; c++) {
+      for (size_t g=0; g<G; g++) {
+        GenericConvolution<double> conv(kernels.middleCols(g*K, K), 1, false, algs[a]);
+        Eigen::MatrixXcd part(n, K);
+        conv.apply(in.col(c*G+g), part);
+        ref.middleCols(c*K, K) += part;
+      }
+    }
+    summed.apply(in, out);
+    UT_ASSERT_NEAR_EPS((out-ref).cwiseAbs().maxCoeff(), 0.0, 1e-10);
+    // Both channels in a single batch
+    GenericConvolution<double>::Workspace ws(summed, 2);
+    out.setZero();
+    summed.apply(in, out, ws);
+    UT_ASSERT_NEAR_EPS((out-ref).cwiseAbs().maxCoeff(), 0.0, 1e-10);
+  }
+}
+
 UnitTest::TestSuite *
 ConvolutionTest::suite()
 {
@@ -63,6 +303,22 @@ ConvolutionTest::suite()
                    "multiple filter", &ConvolutionTest::testMultiple));
   suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
                    "short signal", &ConvolutionTest::testShortSignal));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "real signal", &ConvolutionTest::testReal));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "analytic mode", &ConvolutionTest::testAnalytic));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "odd kernel length", &ConvolutionTest::testOddKernel));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "block algorithms", &ConvolutionTest::testAlgorithms));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "SIMD kernels", &ConvolutionTest::testSIMD));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "interpolated output", &ConvolutionTest::testInterpolated));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "partial convolutions", &ConvolutionTest::testParts));
+  suite->addTest(new UnitTest::TestCaller<ConvolutionTest>(
+                   "summed inputs", &ConvolutionTest::testSummed));
 
   return suite;
 }
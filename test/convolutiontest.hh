@@ -11,6 +11,14 @@ public:
   void testSingle();
   void testMultiple();
   void testShortSignal();
+  void testReal();
+  void testAnalytic();
+  void testOddKernel();
+  void testAlgorithms();
+  void testSIMD();
+  void testInterpolated();
+  void testParts();
+  void testSummed();
 
 public:
   static wt::UnitTest::TestSuite *suite();
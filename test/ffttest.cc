@@ -1,4 +1,5 @@
 #include "ffttest.hh"
+#include <cstdio>
 
 using namespace wt;
 
@@ -44,10 +45,87 @@ FFTTest::testMatrix() {
 }
 
 
+void
+FFTTest::testFloat() {
+  fftw_complex in[8] = {{1,0},{1,0},{0,0},{0,0},{1,0},{1,0},{0,0},{0,0}}, out[8];
+  fftw_plan plan = fftw_plan_dft_1d(8, in, out, FFTW_FORWARD, FFTW_ESTIMATE);
+  fftw_execute(plan);
+
+  Eigen::Matrix<std::complex<float>, Eigen::Dynamic, 1> ein(8), eout(8);
+  ein << 1,1,0,0,1,1,0,0;
+  eout.setZero();
+  FFT<float>::exec(ein, eout, FFT<float>::FORWARD);
+
+  for (int i=0; i<8; i++) {
+    UT_ASSERT_NEAR_EPS(double(eout[i].real()), out[i][0], 1e-6);
+    UT_ASSERT_NEAR_EPS(double(eout[i].imag()), out[i][1], 1e-6);
+  }
+}
+
+
+void
+FFTTest::testRegistry() {
+  Eigen::Matrix<std::complex<double>, Eigen::Dynamic, 1> a(64), b(64), ref(64);
+  for (int i=0; i<64; i++) { a(i) = std::complex<double>(std::sin(i), std::cos(3*i)); }
+  b = a;
+
+  // Plan with measurement, must not touch data and must be shared by FFTs with the same layout
+  FFTPlanRegistry<double>::Rigor rigor = FFTPlanRegistry<double>::rigor();
+  FFTPlanRegistry<double>::setRigor(FFTPlanRegistry<double>::MEASURE);
+  FFT<double> fftA(a, FFT<double>::FORWARD);
+  size_t nplans = FFTPlanRegistry<double>::size();
+  FFT<double> fftB(b, FFT<double>::FORWARD);
+  FFTPlanRegistry<double>::setRigor(rigor);
+  UT_ASSERT_EQUAL(FFTPlanRegistry<double>::size(), nplans);
+  UT_ASSERT_EQUAL(a(3), b(3));
+
+  ref = a;
+  FFT<double>::exec(ref, FFT<double>::FORWARD);
+  fftA.exec(); fftB.exec();
+  for (int i=0; i<64; i++) {
+    UT_ASSERT_NEAR_EPS(a(i).real(), ref(i).real(), 1e-12);
+    UT_ASSERT_NEAR_EPS(a(i).imag(), ref(i).imag(), 1e-12);
+    UT_ASSERT_NEAR_EPS(b(i).real(), ref(i).real(), 1e-12);
+    UT_ASSERT_NEAR_EPS(b(i).imag(), ref(i).imag(), 1e-12);
+  }
+}
+
+
+void
+FFTTest::testWisdom() {
+  std::string filename = "wt_test_wisdom.dat";
+  UT_ASSERT(FFTPlanRegistry<double>::exportWisdom(filename));
+  UT_ASSERT(FFTPlanRegistry<double>::importWisdom(filename));
+  std::remove(filename.c_str());
+  UT_ASSERT(! FFTPlanRegistry<double>::importWisdom(filename));
+}
+
+
+void
+FFTTest::testRoundUp() {
+  // Sizes must be of the form 2^a 3^b 5^c 7^d and not larger than the next power of 2
+  for (size_t N=1; N<5000; N+=37) {
+    size_t n = FFT<double>::roundUp(N), m = n, p2 = 1;
+    while (p2 < N) { p2 *= 2; }
+    UT_ASSERT((n >= N) && (n <= p2));
+    while (0 == (m%2)) { m /= 2; }
+    while (0 == (m%3)) { m /= 3; }
+    while (0 == (m%5)) { m /= 5; }
+    while (0 == (m%7)) { m /= 7; }
+    UT_ASSERT_EQUAL(m, size_t(1));
+  }
+  // A kernel of 1025 samples must not cost a FFT of 2048 samples
+  UT_ASSERT(FFT<double>::roundUp(1025) < 2048);
+}
+
 UnitTest::TestSuite *
 FFTTest::suite() {
   UnitTest::TestSuite *suite = new UnitTest::TestSuite("FFT interface");
   suite->addTest(new UnitTest::TestCaller<FFTTest>("Vector", &FFTTest::testVector));
   suite->addTest(new UnitTest::TestCaller<FFTTest>("Matrix", &FFTTest::testMatrix));
+  suite->addTest(new UnitTest::TestCaller<FFTTest>("Float", &FFTTest::testFloat));
+  suite->addTest(new UnitTest::TestCaller<FFTTest>("Plan registry", &FFTTest::testRegistry));
+  suite->addTest(new UnitTest::TestCaller<FFTTest>("Wisdom", &FFTTest::testWisdom));
+  suite->addTest(new UnitTest::TestCaller<FFTTest>("Round up", &FFTTest::testRoundUp));
   return suite;
 }
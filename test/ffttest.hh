@@ -10,6 +10,10 @@ class FFTTest: public wt::UnitTest::TestCase
 public:
   void testVector();
   void testMatrix();
+  void testFloat();
+  void testRegistry();
+  void testWisdom();
+  void testRoundUp();
 
   static wt::UnitTest::TestSuite *suite();
 };
@@ -0,0 +1,134 @@
+#include "filterbankcachetest.hh"
+#include "filterbankcache.hh"
+#include "wavelettransform.hh"
+#include "waveletsynthesis.hh"
+#include <vector>
+
+using namespace wt;
+
+
+void
+FilterBankCacheTest::setUp() {
+  _capacity = FilterBankCache::capacity();
+  FilterBankCache::clear();
+}
+
+void
+FilterBankCacheTest::tearDown() {
+  FilterBankCache::setCapacity(_capacity);
+  FilterBankCache::clear();
+}
+
+void
+FilterBankCacheTest::testShared() {
+  Eigen::VectorXd scales(16);
+  linear_range(4, 64, scales);
+
+  // Identical transforms share the filter bank
+  WaveletTransform a(Morlet(2), scales), b(Morlet(2), scales);
+  UT_ASSERT(a.filterBank() == b.filterBank());
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(1));
+  UT_ASSERT_EQUAL(FilterBankCache::hits(), size_t(1));
+  UT_ASSERT_EQUAL(FilterBankCache::memory(), a.filterBank()->memory());
+
+  // Different options, wavelets or scales do not
+  WaveletTransform c(Morlet(2), scales, true, false);
+  WaveletTransform d(Morlet(3), scales);
+  WaveletTransform e(Cauchy(2), scales);
+  WaveletTransform f(Morlet(2), scales.tail(8));
+  UT_ASSERT(a.filterBank() != c.filterBank());
+  UT_ASSERT(a.filterBank() != d.filterBank());
+  UT_ASSERT(a.filterBank() != e.filterBank());
+  UT_ASSERT(a.filterBank() != f.filterBank());
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(5));
+  // ... nor does a different precision
+  GenericWaveletTransform<float> ef(Cauchy(2), scales);
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(6));
+
+  // Cached causal filter banks restore the group delays
+  WaveletTransform g(Morlet(2), scales, true, true, true), h(Morlet(2), scales, true, true, true);
+  UT_ASSERT(g.filterBank() == h.filterBank());
+  UT_ASSERT((g.groupDelays()-h.groupDelays()).cwiseAbs().maxCoeff() == 0);
+  UT_ASSERT(g.groupDelays().maxCoeff() > 0);
+
+  // The syntheses are cached separately
+  size_t items = FilterBankCache::size();
+  WaveletSynthesis s(a), t(b);
+  UT_ASSERT_EQUAL(FilterBankCache::size(), items+1);
+
+  // Clearing the cache keeps the filter banks in use valid
+  FilterBankCache::clear();
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(0));
+  UT_ASSERT_EQUAL(FilterBankCache::memory(), size_t(0));
+  WaveletTransform i(Morlet(2), scales);
+  UT_ASSERT(a.filterBank() != i.filterBank());
+
+  Eigen::VectorXcd signal = Eigen::VectorXcd::Zero(256); signal(128) = 1;
+  Eigen::MatrixXcd ra(256, 16), ri(256, 16);
+  a(signal, ra); i(signal, ri);
+  UT_ASSERT((ra-ri).cwiseAbs().maxCoeff() == 0);
+}
+
+void
+FilterBankCacheTest::testEviction() {
+  Eigen::VectorXd scales(16);
+  linear_range(4, 64, scales);
+  WaveletTransform a(Morlet(2), scales);
+  size_t bytes = a.filterBank()->memory();
+
+  // Room for a single filter bank -> the least recently used one is dropped
+  FilterBankCache::setCapacity(bytes+bytes/2);
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(1));
+  WaveletTransform b(Morlet(3), scales);
+  UT_ASSERT(FilterBankCache::memory() <= FilterBankCache::capacity());
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(1));
+  WaveletTransform c(Morlet(2), scales);
+  UT_ASSERT(a.filterBank() != c.filterBank());
+  WaveletTransform d(Morlet(2), scales);
+  UT_ASSERT(c.filterBank() == d.filterBank());
+
+  // A capacity of 0 disables the cache
+  FilterBankCache::setCapacity(0);
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(0));
+  WaveletTransform e(Morlet(2), scales), f(Morlet(2), scales);
+  UT_ASSERT(e.filterBank() != f.filterBank());
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(0));
+}
+
+void
+FilterBankCacheTest::testConcurrent() {
+  Eigen::VectorXd scales(32);
+  linear_range(4, 128, scales);
+  Eigen::VectorXcd signal = Eigen::VectorXcd::Random(1024);
+  Eigen::MatrixXcd expected(1024, 32);
+  WaveletTransform(Morlet(2), scales)(signal, expected);
+  FilterBankCache::clear();
+
+  // Construct and apply identical transforms concurrently, all of them must yield the same
+  // result
+  const int n = 8;
+  std::vector<Eigen::MatrixXcd> results(n, Eigen::MatrixXcd(1024, 32));
+  #pragma omp parallel for
+  for (int i=0; i<n; i++) {
+    WaveletTransform wt(Morlet(2), scales);
+    wt(signal, results[i]);
+  }
+  UT_ASSERT_EQUAL(FilterBankCache::size(), size_t(1));
+  for (int i=0; i<n; i++)
+    UT_ASSERT((results[i]-expected).cwiseAbs().maxCoeff() < 1e-12);
+}
+
+
+UnitTest::TestSuite *
+FilterBankCacheTest::suite() {
+  UnitTest::TestSuite *suite = new UnitTest::TestSuite("Filter Bank Cache Test");
+
+  suite->addTest(new UnitTest::TestCaller<FilterBankCacheTest>(
+                   "shared filter banks", &FilterBankCacheTest::testShared));
+  suite->addTest(new UnitTest::TestCaller<FilterBankCacheTest>(
+                   "eviction", &FilterBankCacheTest::testEviction));
+  suite->addTest(new UnitTest::TestCaller<FilterBankCacheTest>(
+                   "concurrent construction", &FilterBankCacheTest::testConcurrent));
+
+  return suite;
+}
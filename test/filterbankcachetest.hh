@@ -0,0 +1,24 @@
+#ifndef FILTERBANKCACHETEST_HH
+#define FILTERBANKCACHETEST_HH
+
+#include "utils/unittest.hh"
+
+class FilterBankCacheTest : public wt::UnitTest::TestCase
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testShared();
+  void testEviction();
+  void testConcurrent();
+
+public:
+  static wt::UnitTest::TestSuite *suite();
+
+protected:
+  /** The capacity of the cache before the test. */
+  size_t _capacity;
+};
+
+#endif // FILTERBANKCACHETEST_HH
@@ -8,6 +8,7 @@
 #include "wavelettransformtest.hh"
 #include "waveletsynthesistest.hh"
 #include "waveletconvolutiontest.hh"
+#include "filterbankcachetest.hh"
 
 
 using namespace wt;
@@ -29,6 +30,7 @@ int main(int argc, char *argv[]) {
   runner.addSuite(WaveletTransformTest::suite());
   runner.addSuite(WaveletSynthesisTest::suite());
   runner.addSuite(WaveletConvolutionTest::suite());
+  runner.addSuite(FilterBankCacheTest::suite());
 
   // Exec tests:
   runner();
@@ -1,5 +1,6 @@
 #include "waveletconvolutiontest.hh"
 #include "wavelettransform.hh"
+#include "waveletsynthesis.hh"
 #include "waveletconvolution.hh"
 #include <iostream>
 
@@ -30,6 +31,90 @@ WaveletConvolutionTest::testConvolution() {
   // Do not test anything, its bad anyway
 }
 
+/** Collects the blocks passed to the sink into a matrix. */
+class ProjectionSink: public BlockSink
+{
+public:
+  ProjectionSink(size_t rows, size_t cols) : result(Eigen::MatrixXcd::Zero(rows, cols)) { }
+
+  virtual void operator() (size_t row, size_t col, const Eigen::Ref<const CMatrix> &block) {
+    result.block(row, col, block.rows(), block.cols()) += block;
+  }
+
+  Eigen::MatrixXcd result;
+};
+
+void
+WaveletConvolutionTest::testWorkspace() {
+  // Repeated projections sharing a workspace and the block sink must yield the same result
+  int N=3000, Nscales=16;
+  Eigen::VectorXd scales(Nscales);
+  for (int j=0; j<Nscales; j++) { scales(j) = 4*std::pow(1.2, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  Eigen::MatrixXcd transformed(N, Nscales);
+  GenericWaveletTransform<double> wt(Morlet(), scales);
+  wt(signal, transformed);
+
+  GenericWaveletConvolution<double> P(wt);
+  GenericWaveletConvolution<double>::Workspace workspace;
+  Eigen::MatrixXcd ref(N, Nscales), proj(N, Nscales);
+  P(transformed, ref);
+  double eps = 1e-10*ref.cwiseAbs().maxCoeff();
+  for (int i=0; i<2; i++) {
+    P(transformed, proj, workspace);
+    UT_ASSERT((proj-ref).cwiseAbs().maxCoeff() < eps);
+  }
+  ProjectionSink sink(N, Nscales);
+  P(transformed, sink);
+  UT_ASSERT((sink.result-ref).cwiseAbs().maxCoeff() < eps);
+}
+
+void
+WaveletConvolutionTest::testSynthesis() {
+  // The projection by synthesis and transform must equal their (normalized) composition and
+  // agree with the direct method
+  int N=4000, Nscales=24;
+  Eigen::VectorXd scales(Nscales);
+  for (int j=0; j<Nscales; j++) { scales(j) = 4*std::pow(25., double(j)/(Nscales-1)); }
+  Eigen::VectorXd signal(N);
+  for (int i=0; i<N; i++) {
+    signal(i) = std::cos(2*M_PI*i/20.) + 0.5*std::sin(2*M_PI*i/37.) + 0.3*std::cos(2*M_PI*i/61.);
+  }
+  Eigen::MatrixXcd transformed(N, Nscales);
+  GenericWaveletTransform<double> wt(Morlet(), scales);
+  wt(signal, transformed);
+
+  Eigen::VectorXcd reconst(N);
+  GenericWaveletSynthesis<double> ws(wt);
+  ws(transformed, reconst);
+  Eigen::MatrixXcd ref(N, Nscales);
+  wt(reconst, ref);
+
+  GenericWaveletConvolution<double> P(wt, GenericWaveletConvolution<double>::SYNTHESIS);
+  // For the Morlet wavelet, the ratio of the reproducing kernel and the convolution of the
+  // wavelets is dff
+  UT_ASSERT_NEAR_EPS(P.normalization().real(), 2., 1e-8);
+  UT_ASSERT(std::abs(P.normalization().imag()) < 1e-8);
+  ref *= P.normalization();
+  GenericWaveletConvolution<double>::Workspace workspace;
+  Eigen::MatrixXcd proj(N, Nscales);
+  double eps = 1e-10*ref.cwiseAbs().maxCoeff();
+  for (int i=0; i<2; i++) {
+    P(transformed, proj, workspace);
+    UT_ASSERT((proj-ref).cwiseAbs().maxCoeff() < eps);
+  }
+  ProjectionSink sink(N, Nscales);
+  P(transformed, sink);
+  UT_ASSERT((sink.result-ref).cwiseAbs().maxCoeff() < eps);
+
+  // Compare the interior with the direct method
+  GenericWaveletConvolution<double> D(wt);
+  UT_ASSERT(D.normalization() == std::complex<double>(1));
+  Eigen::MatrixXcd direct(N, Nscales);
+  D(transformed, direct);
+  Eigen::MatrixXcd a = direct.middleRows(N/4, N/2), b = proj.middleRows(N/4, N/2);
+  UT_ASSERT((a-b).norm() < 0.005*a.norm());
+}
 
 
 UnitTest::TestSuite *
@@ -38,6 +123,10 @@ WaveletConvolutionTest::suite() {
 
   suite->addTest(new UnitTest::TestCaller<WaveletConvolutionTest>(
                    "auto-proj.", &WaveletConvolutionTest::testConvolution));
+  suite->addTest(new UnitTest::TestCaller<WaveletConvolutionTest>(
+                   "workspace reuse", &WaveletConvolutionTest::testWorkspace));
+  suite->addTest(new UnitTest::TestCaller<WaveletConvolutionTest>(
+                   "synthesis and transform", &WaveletConvolutionTest::testSynthesis));
 
   return suite;
 }
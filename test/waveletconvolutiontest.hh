@@ -7,6 +7,8 @@ class WaveletConvolutionTest : public wt::UnitTest::TestCase
 {
 public:
   void testConvolution();
+  void testWorkspace();
+  void testSynthesis();
 
 public:
   static wt::UnitTest::TestSuite *suite();
@@ -1,6 +1,7 @@
 #include "waveletsynthesistest.hh"
 #include "wavelettransform.hh"
 #include "waveletsynthesis.hh"
+#include "convolution.hh"
 #include <iostream>
 
 using namespace wt;
@@ -30,6 +31,108 @@ WaveletSynthesisTest::testSynthesis() {
   // Do not test anything, its bad anyway
 }
 
+/** Collects the blocks passed to the sink into a vector. */
+class ReconstSink: public BlockSink
+{
+public:
+  ReconstSink(size_t rows) : result(Eigen::VectorXcd::Zero(rows)) { }
+
+  virtual void operator() (size_t row, size_t, const Eigen::Ref<const CMatrix> &block) {
+    result.segment(row, block.rows()) += block.col(0);
+  }
+
+  Eigen::VectorXcd result;
+};
+
+void
+WaveletSynthesisTest::testBlockSink() {
+  // The blocks passed to the sink and repeated syntheses sharing a workspace must assemble the
+  // reconstruction
+  int N=10000, Nscales=32;
+  Eigen::VectorXd scales(Nscales);
+  for (int j=0; j<Nscales; j++) { scales(j) = 4*std::pow(1.1, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  Eigen::MatrixXcd transformed(N, Nscales);
+  GenericWaveletTransform<double> wt(Morlet(), scales);
+  wt(signal, transformed);
+
+  GenericWaveletSynthesis<double> ws(wt);
+  Eigen::VectorXcd reconst(N);
+  ws(transformed, reconst);
+  ReconstSink sink(N);
+  ws(transformed, sink);
+  UT_ASSERT((sink.result-reconst).cwiseAbs().maxCoeff() < 1e-10*reconst.cwiseAbs().maxCoeff());
+
+  // The workspace keeps the working memory of the filter bank, also if it gets used by another
+  // synthesis in-between
+  GenericWaveletSynthesis<double>::Workspace workspace;
+  GenericWaveletSynthesis<double> other(Cauchy(), scales.head(16));
+  Eigen::VectorXcd result(N), otherRef(N);
+  other(transformed.leftCols(16), otherRef);
+  for (int i=0; i<2; i++) {
+    ws(transformed, result, workspace);
+    UT_ASSERT((result-reconst).cwiseAbs().maxCoeff() < 1e-10*reconst.cwiseAbs().maxCoeff());
+    other(transformed.leftCols(16), result, workspace);
+    UT_ASSERT((result-otherRef).cwiseAbs().maxCoeff() < 1e-10*otherRef.cwiseAbs().maxCoeff());
+  }
+}
+
+
+/** Computes the synthesis of @c transformed scale by scale, using separate convolutions with
+ * the weighted time-domain synthesis wavelets. */
+static Eigen::VectorXcd
+referenceSynthesis(const Wavelet &wavelet, const Eigen::VectorXd &scales,
+                   const Eigen::MatrixXcd &transformed) {
+  int N = transformed.rows(), K = scales.size();
+  Eigen::VectorXcd result = Eigen::VectorXcd::Zero(N), current(N);
+  for (int j=0; j<K; j++) {
+    // Trapezoidal rule over the scales
+    double weight = (scales(std::min(j+1, K-1)) - scales(std::max(j-1, 0)))/2;
+    size_t M = FFT<double>::roundUp(std::ceil(scales(j)*2*wavelet.cutOffTime()));
+    Eigen::MatrixXcd kernel(M, 1);
+    for (size_t i=0; i<M; i++) {
+      kernel(i, 0) = weight * wavelet.normConstant() *
+          wavelet.evalSynthesis((i-double(M)/2)/scales(j)) / scales(j) / scales(j);
+    }
+    Convolution(kernel).apply(transformed.col(j), current);
+    result += current;
+  }
+  return result;
+}
+
+void
+WaveletSynthesisTest::testReference() {
+  // The grouped synthesis must equal the sum of the per-scale convolutions. The scales span
+  // five octaves, i.e. several groups of scales
+  int N=4000, Nscales=24;
+  Eigen::VectorXd scales(Nscales);
+  for (int j=0; j<Nscales; j++) { scales(j) = 4*std::pow(32., double(j)/(Nscales-1)); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  Eigen::MatrixXcd transformed(N, Nscales);
+  GenericWaveletTransform<double> wt(Morlet(), scales);
+  wt(signal, transformed);
+
+  // A Morlet wavelet w/o closed-form spectrum is synthesized from time-domain kernels, hence
+  // both agree up to the rounding errors of the FFTs
+  class TimeDomainMorlet: public MorletObj {
+  public:
+    TimeDomainMorlet() : MorletObj(2) { }
+    virtual bool hasSpectrum() const { return false; }
+    virtual std::string identifier() const { return ""; }
+  };
+  Wavelet timeDomain(new TimeDomainMorlet());
+  GenericWaveletSynthesis<double> ws(timeDomain, scales);
+  Eigen::VectorXcd reconst(N);
+  ws(transformed, reconst);
+  Eigen::VectorXcd ref = referenceSynthesis(timeDomain, scales, transformed);
+  UT_ASSERT((reconst-ref).cwiseAbs().maxCoeff() < 1e-12*ref.cwiseAbs().maxCoeff());
+
+  // The sampled spectra are not truncated, hence the difference is the truncation error of
+  // the time-domain kernels
+  GenericWaveletSynthesis<double> wsF(Morlet(), scales);
+  wsF(transformed, reconst);
+  UT_ASSERT((reconst-ref).norm() < 1e-3*ref.norm());
+}
 
 
 UnitTest::TestSuite *
@@ -38,6 +141,10 @@ WaveletSynthesisTest::suite() {
 
   suite->addTest(new UnitTest::TestCaller<WaveletSynthesisTest>(
                    "synthesis", &WaveletSynthesisTest::testSynthesis));
+  suite->addTest(new UnitTest::TestCaller<WaveletSynthesisTest>(
+                   "block sink", &WaveletSynthesisTest::testBlockSink));
+  suite->addTest(new UnitTest::TestCaller<WaveletSynthesisTest>(
+                   "per-scale reference", &WaveletSynthesisTest::testReference));
 
   return suite;
 }
@@ -7,6 +7,8 @@ class WaveletSynthesisTest : public wt::UnitTest::TestCase
 {
 public:
   void testSynthesis();
+  void testBlockSink();
+  void testReference();
 
 public:
   static wt::UnitTest::TestSuite *suite();
@@ -1,9 +1,31 @@
 #include "wavelettransformtest.hh"
 #include "wavelettransform.hh"
+#include "spectralwavelettransform.hh"
+#include "streamingwavelettransform.hh"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
 
 using namespace wt;
 
+/** Collects the blocks passed to the sink into a matrix. */
+class GatherSink: public BlockSink
+{
+public:
+  GatherSink(size_t rows, size_t cols)
+    : result(Eigen::MatrixXcd::Zero(rows, cols)), count(Eigen::MatrixXi::Zero(rows, cols)) { }
+
+  virtual void operator() (size_t row, size_t col, const Eigen::Ref<const CMatrix> &block) {
+    result.block(row, col, block.rows(), block.cols()) = block;
+    count.block(row, col, block.rows(), block.cols()).array() += 1;
+  }
+
+  Eigen::MatrixXcd result;
+  Eigen::MatrixXi count;
+};
+
 void
 WaveletTransformTest::testTrafo() {
   // Delta peak
@@ -18,7 +40,13 @@ WaveletTransformTest::testTrafo() {
 
   GenericWaveletTransform<double> wt(Morlet(), scales);
   wt(signal, transformed);
+  // The kernel is limited to M samples, centered at M/2
+  int M = wt.filterBank()->group(0).kernelLength();
   for (int i=0; i<N; i++) {
+    if (((i-N/2) < -M/2) || ((i-N/2) >= M-M/2)) {
+      UT_ASSERT(std::abs(transformed(i,0)) < 1e-12);
+      continue;
+    }
     UT_ASSERT_NEAR_EPS(
           transformed(i,0).real(), wt.wavelet().evalAnalysis(double(i-N/2)/scale).real()/scale, 1e-5);
     UT_ASSERT_NEAR_EPS(
@@ -50,6 +78,478 @@ WaveletTransformTest::testSubsample() {
 }
 
 
+void
+WaveletTransformTest::testFloat() {
+  // Delta peak
+  int N=16*1024;
+  int Nscales = 4;
+  double scale = 200;
+  Eigen::VectorXcd signal = Eigen::VectorXcd::Zero(N); signal(N/2) = 1;
+  // Single precision transform must match the double precision one (w/ and w/o sub-sampling)
+  Eigen::VectorXd scales(Nscales); scales.setConstant(scale);
+  Eigen::MatrixXcd transformed(N, Nscales);
+  Eigen::MatrixXcf transformedF(N, Nscales);
+
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    GenericWaveletTransform<float> wtF(Morlet(), scales, sub);
+    wt(signal, transformed);
+    wtF(signal, transformedF);
+    for (int i=0; i<N; i++) {
+      UT_ASSERT_NEAR_EPS(double(transformedF(i,0).real()), transformed(i,0).real(), 1e-6);
+      UT_ASSERT_NEAR_EPS(double(transformedF(i,0).imag()), transformed(i,0).imag(), 1e-6);
+    }
+  }
+}
+
+
+void
+WaveletTransformTest::testSpectrum() {
+  // The closed-form spectra must match the numerical Fourier transforms of the wavelets
+  Wavelet wavelets[4] = { Morlet(), RegMorlet(), Cauchy(), RegCauchy() };
+  double freqs[5] = { -1.5, -0.7, 0.3, 1.0, 1.8 };
+  double dt = 1e-3, T = 200;
+  for (int w=0; w<4; w++) {
+    UT_ASSERT(wavelets[w].hasSpectrum());
+    for (int k=0; k<5; k++) {
+      std::complex<double> F = 0;
+      for (double t=-T; t<T; t+=dt) {
+        F += wavelets[w].evalAnalysis(t)*std::polar(dt, -2*M_PI*freqs[k]*t);
+      }
+      std::complex<double> G = wavelets[w].evalAnalysisSpectrum(freqs[k]);
+      UT_ASSERT_NEAR_EPS(G.real(), F.real(), 1e-3);
+      UT_ASSERT_NEAR_EPS(G.imag(), F.imag(), 1e-3);
+    }
+  }
+}
+
+
+void
+WaveletTransformTest::testSpectralTrafo() {
+  // Delta peak
+  int N=16*1024;
+  double scale = 200;
+  Eigen::VectorXd signal = Eigen::VectorXd::Zero(N); signal(N/2) = 1;
+  // Perform WT of delta-peak -> evaluation of wavelet at that scale, the real and complex
+  // signals as well as the wavelets with and w/o closed-form spectrum must give the same result.
+  Eigen::VectorXd scales(3); scales << 50, scale, 100;
+  Eigen::MatrixXcd transformed(N, 3), ctransformed(N, 3);
+
+  GenericSpectralWaveletTransform<double> wt(Morlet(), scales, 2);
+  wt(signal, transformed);
+  wt(Eigen::VectorXcd(signal.cast< std::complex<double> >()), ctransformed);
+  for (int i=0; i<N; i++) {
+    std::complex<double> ref = wt.wavelet().evalAnalysis(double(i-N/2)/scale)/scale;
+    UT_ASSERT_NEAR_EPS(transformed(i,1).real(), ref.real(), 1e-6);
+    UT_ASSERT_NEAR_EPS(transformed(i,1).imag(), ref.imag(), 1e-6);
+    UT_ASSERT_NEAR_EPS(ctransformed(i,1).real(), ref.real(), 1e-6);
+    UT_ASSERT_NEAR_EPS(ctransformed(i,1).imag(), ref.imag(), 1e-6);
+  }
+
+  // The cached spectra of the wavelets and the spectra sampled batch by batch (if they exceed
+  // the capacity of the cache) give the same result
+  size_t capacity = FilterBankCache::capacity();
+  FilterBankCache::setCapacity(0);
+  wt(signal, ctransformed);
+  FilterBankCache::setCapacity(capacity);
+  UT_ASSERT((transformed-ctransformed).cwiseAbs().maxCoeff() < 1e-14);
+
+  // A Cauchy wavelet w/o closed-form spectrum is transformed in the time domain
+  class TimeDomainCauchy: public CauchyObj {
+  public:
+    virtual bool hasSpectrum() const { return false; }
+  };
+  GenericSpectralWaveletTransform<double> wtF(Cauchy(), scales), wtT(Wavelet(new TimeDomainCauchy()), scales);
+  wtF(signal, transformed);
+  wtT(signal, ctransformed);
+  for (int i=0; i<N; i++) {
+    UT_ASSERT_NEAR_EPS(transformed(i,1).real(), ctransformed(i,1).real(), 1e-4);
+    UT_ASSERT_NEAR_EPS(transformed(i,1).imag(), ctransformed(i,1).imag(), 1e-4);
+  }
+
+  // Short signals at large scales are transformed faster in the frequency domain, long signals
+  // at small scales by the block convolution
+  UT_ASSERT(preferSpectralTransform(Morlet(), scales, 1024));
+  UT_ASSERT(! preferSpectralTransform(Morlet(), scales, 1024*1024));
+}
+
+
+void
+WaveletTransformTest::testGrouping() {
+  // A dyadic grid spanning 6 octaves
+  Eigen::VectorXd scales(48);
+  dyadic_range(4, 256, scales);
+  WaveletTransform wt(Morlet(), scales, true);
+  const GenericFilterBank<double> &bank = *wt.filterBank();
+
+  // Each group holds kernels of at most twice the length of its shortest kernel
+  UT_ASSERT(bank.numGroups() >= 6);
+  for (size_t j=0; j<bank.numGroups(); j++) {
+    double shortest = std::ceil(scales(bank.offset(j))*2*wt.wavelet().cutOffTime());
+    UT_ASSERT(bank.group(j).kernelLength() <= 2*FFT<double>::roundUp(shortest));
+  }
+}
+
+
+void
+WaveletTransformTest::testChannels() {
+  // Transforming several channels at once must match the transforms of the single channels
+  // (w/ and w/o sub-sampling, complex and real signals, more channels than a single batch)
+  int N=4*1024, C=10;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::MatrixXd signals = Eigen::MatrixXd::Random(N, C);
+  Eigen::MatrixXcd csignals = signals.cast< std::complex<double> >();
+  Eigen::MatrixXcd transformed(N, 12*C), ctransformed(N, 12*C), single(N, 12);
+
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    wt(signals, transformed);
+    wt(csignals, ctransformed);
+    for (int c=0; c<C; c++) {
+      wt(csignals.col(c), single);
+      UT_ASSERT((transformed.middleCols(c*12, 12)-single).cwiseAbs().maxCoeff() < 1e-10);
+      UT_ASSERT((ctransformed.middleCols(c*12, 12)-single).cwiseAbs().maxCoeff() < 1e-10);
+    }
+  }
+}
+
+
+void
+WaveletTransformTest::testConcurrent() {
+  // A transform (and copies sharing its filter bank) can be applied from several threads
+  int N=4*1024, T=4;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::MatrixXcd signals = Eigen::MatrixXcd::Random(N, T);
+  std::vector<Eigen::MatrixXcd> results(T, Eigen::MatrixXcd(N, 12));
+
+  GenericWaveletTransform<double> wt(Morlet(), scales, true);
+  GenericWaveletTransform<double> copy(wt);
+  UT_ASSERT(wt.filterBank() == copy.filterBank());
+  #pragma omp parallel for
+  for (int t=0; t<T; t++) {
+    if (t % 2)
+      wt(signals.col(t), results[t]);
+    else
+      copy(signals.col(t), results[t]);
+  }
+  Eigen::MatrixXcd single(N, 12);
+  for (int t=0; t<T; t++) {
+    wt(signals.col(t), single);
+    UT_ASSERT((results[t]-single).cwiseAbs().maxCoeff() < 1e-12);
+  }
+}
+
+void
+WaveletTransformTest::testStreaming() {
+  // Pushing a signal in chunks of varying size must reproduce the transform of the complete
+  // signal, with and without sub-sampling. The blocks differ from the batch transform, but the
+  // (frequency domain) kernels are limited to their length, hence the results agree
+  int N=3000;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  int chunks[5] = {1, 7, 250, 33, 1024};
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    Eigen::MatrixXcd ref(N, 12);
+    wt(signal, ref);
+
+    GenericStreamingWaveletTransform<double> stream(Morlet(), scales, sub);
+    Eigen::MatrixXcd result(N, 12), rows;
+    int n=0, r=0;
+    for (int i=0; n<N; i++) {
+      int m = std::min(chunks[i%5], N-n);
+      size_t k = stream.push(signal.segment(n, m), rows);
+      UT_ASSERT(int(r+k) <= n+m);
+      result.middleRows(r, k) = rows; r += k; n += m;
+    }
+    size_t k = stream.flush(rows);
+    UT_ASSERT_EQUAL(int(r+k), N);
+    result.middleRows(r, k) = rows;
+    UT_ASSERT((result-ref).cwiseAbs().maxCoeff() < 1e-10);
+
+    // Pushing single samples with a minimum block length delays the rows by at most that many
+    // samples
+    GenericStreamingWaveletTransform<double> minimal(Morlet(), scales, sub);
+    minimal.setMinBlockLength(64);
+    UT_ASSERT_EQUAL(minimal.minBlockLength(), size_t(64));
+    result.setZero();
+    for (n=0; n<N; n++) {
+      stream.push(signal.segment(n, 1), rows);
+      size_t k = minimal.push(signal.segment(n, 1), rows);
+      result.middleRows(minimal.numRows()-k, k) = rows;
+      UT_ASSERT(minimal.numRows()+64 >= stream.numRows());
+    }
+    k = minimal.flush(rows);
+    result.middleRows(N-k, k) = rows;
+    stream.flush(rows);
+    UT_ASSERT((result-ref).cwiseAbs().maxCoeff() < 1e-10);
+  }
+}
+
+void
+WaveletTransformTest::testCausal() {
+  // The causal transform at time t must not depend on samples after t
+  int N=2048, t0=1000;
+  Eigen::VectorXd scales(8);
+  for (int j=0; j<8; j++) { scales(j) = 4*std::pow(1.5, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N), changed = signal;
+  changed.tail(N-t0-1).setRandom();
+
+  GenericWaveletTransform<double> wt(RegMorlet(), scales, false, false, true);
+  UT_ASSERT(wt.causal());
+  for (int j=1; j<8; j++) { UT_ASSERT(wt.groupDelays()(j) > wt.groupDelays()(j-1)); }
+  Eigen::MatrixXcd a(N, 8), b(N, 8);
+  wt(signal, a); wt(changed, b);
+  UT_ASSERT((a.topRows(t0+1)-b.topRows(t0+1)).cwiseAbs().maxCoeff() < 1e-12);
+  UT_ASSERT((a.bottomRows(N-t0-1)-b.bottomRows(N-t0-1)).cwiseAbs().maxCoeff() > 1e-3);
+
+  // The sub-sampled causal transform is causal too, the interpolation adds two sub-samples to
+  // the delays
+  GenericWaveletTransform<double> sub(RegMorlet(), scales, true, false, true);
+  const GenericFilterBank<double> &bank = *sub.filterBank();
+  size_t S = bank.group(bank.numGroups()-1).subSampling();
+  UT_ASSERT(1 < S);
+  UT_ASSERT(sub.groupDelays()(7) >= wt.groupDelays()(7)+S);
+  sub(signal, a); sub(changed, b);
+  UT_ASSERT((a.topRows(t0+1)-b.topRows(t0+1)).cwiseAbs().maxCoeff() < 1e-12);
+  UT_ASSERT((a.bottomRows(N-t0-1)-b.bottomRows(N-t0-1)).cwiseAbs().maxCoeff() > 1e-3);
+  wt(signal, a);
+
+  // The centered transform has no delay
+  GenericWaveletTransform<double> centered(RegMorlet(), scales);
+  UT_ASSERT_EQUAL(centered.groupDelays().cwiseAbs().maxCoeff(), 0.);
+
+  // Streaming: every pushed sample yields a finished row
+  GenericStreamingWaveletTransform<double> stream(RegMorlet(), scales, false, false, true);
+  Eigen::MatrixXcd rows;
+  for (int n=0; n<N; n+=100) {
+    int m = std::min(100, N-n);
+    UT_ASSERT_EQUAL(int(stream.push(signal.segment(n, m), rows)), m);
+    UT_ASSERT((rows-a.middleRows(n, m)).cwiseAbs().maxCoeff() < 1e-10);
+  }
+  UT_ASSERT_EQUAL(int(stream.flush(rows)), 0);
+}
+
+void
+WaveletTransformTest::testDecimated() {
+  // The decimated transform must yield every D-th row of the full transform
+  int N=1001;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  int decimations[3] = {1, 5, 16};
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    Eigen::MatrixXcd full(N, 12);
+    wt(signal, full);
+    for (int d=0; d<3; d++) {
+      int D = decimations[d], n = WT_IDIV_CEIL(N, D);
+      Eigen::MatrixXcd out(n, 12);
+      wt.decimated(signal, out, D);
+      for (int i=0; i<n; i++) {
+        UT_ASSERT((out.row(i)-full.row(i*D)).cwiseAbs().maxCoeff() < 1e-12);
+      }
+    }
+  }
+}
+
+void
+WaveletTransformTest::testMapped() {
+  // Transform into a memory mapped NPY file
+  int N=4096, C=2;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::MatrixXd signal = Eigen::MatrixXd::Random(N, C);
+  GenericWaveletTransform<double> wt(Morlet(), scales, true);
+  Eigen::MatrixXcd ref(N, 12*C);
+  wt(signal, ref);
+
+  const char *filename = "wavelettransformtest_mapped.npy";
+  {
+    MappedMatrix mapped(filename, N, 12*C);
+    UT_ASSERT_EQUAL(int(mapped.headerSize() % 64), 0);
+    wt(signal, mapped);
+    UT_ASSERT((mapped.matrix()-ref).cwiseAbs().maxCoeff() < 1e-12);
+    mapped.sync();
+  }
+  // Check NPY header and size of file
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  size_t size = file.tellg();
+  file.seekg(0);
+  char magic[6];
+  file.read(magic, 6);
+  UT_ASSERT(0 == std::memcmp(magic, "\x93NUMPY", 6));
+  UT_ASSERT_EQUAL(int(size), int(128 + N*12*C*sizeof(std::complex<double>)));
+  file.close();
+  std::remove(filename);
+}
+
+void
+WaveletTransformTest::testBlockSink() {
+  // The blocks passed to a sink must assemble the matrix output, every element exactly once
+  int N=5001, C=3;
+  Eigen::VectorXd scales(16);
+  for (int j=0; j<16; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::MatrixXd signal = Eigen::MatrixXd::Random(N, C);
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    for (int D=1; D<8; D+=6) {
+      int n = WT_IDIV_CEIL(N, D);
+      Eigen::MatrixXcd ref(n, 16*C);
+      wt.decimated(signal, ref, D);
+      GatherSink sink(n, 16*C);
+      wt.decimated(signal, sink, D);
+      UT_ASSERT_EQUAL(sink.count.minCoeff(), 1);
+      UT_ASSERT_EQUAL(sink.count.maxCoeff(), 1);
+      UT_ASSERT((sink.result-ref).cwiseAbs().maxCoeff() < 1e-12);
+    }
+  }
+}
+
+void
+WaveletTransformTest::testOutputModes() {
+  // The real outputs must match the quantities of the complex transform
+  int N=3001;
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(N);
+  for (int sub=0; sub<2; sub++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, sub);
+    Eigen::MatrixXcd ref(N, 12);
+    wt(signal, ref);
+    Eigen::MatrixXd out(N, 12);
+    wt(signal, out, OUTPUT_MODULUS);
+    UT_ASSERT((out-ref.cwiseAbs()).cwiseAbs().maxCoeff() < 1e-12);
+    wt(signal, out, OUTPUT_POWER);
+    UT_ASSERT((out-ref.cwiseAbs2()).cwiseAbs().maxCoeff() < 1e-12);
+    wt(signal, out, OUTPUT_LOG_POWER);
+    UT_ASSERT((out.array().exp()-ref.cwiseAbs2().array()).abs().maxCoeff() < 1e-12);
+    wt(signal, out, OUTPUT_PHASE);
+    for (int j=0; j<12; j++) {
+      for (int i=0; i<N; i++) {
+        UT_ASSERT(std::abs(std::polar(1., out(i,j))*std::abs(ref(i,j))-ref(i,j)) < 1e-12);
+      }
+    }
+    // Single precision, decimated power
+    Eigen::MatrixXf power(WT_IDIV_CEIL(N, 4), 12);
+    wt.decimated(signal, power, 4, OUTPUT_POWER);
+    for (int i=0; i<power.rows(); i++) {
+      UT_ASSERT((power.row(i).cast<double>()-ref.row(4*i).cwiseAbs2()).cwiseAbs().maxCoeff()
+                < 1e-5*ref.row(4*i).cwiseAbs2().maxCoeff());
+    }
+  }
+  // The type of the output must match the mode
+  GenericWaveletTransform<double> wt(Morlet(), scales);
+  Eigen::MatrixXd out(N, 12);
+  bool thrown = false;
+  try { wt(signal, out, OUTPUT_COMPLEX); } catch (ValueError &err) { thrown = true; }
+  UT_ASSERT(thrown);
+}
+
+void
+WaveletTransformTest::testWorkspace() {
+  // A workspace can be reused for signals of varying size and type
+  Eigen::VectorXd scales(12);
+  for (int j=0; j<12; j++) { scales(j) = 4*std::pow(1.4, j); }
+  GenericWaveletTransform<double> wt(Morlet(), scales, true);
+  GenericWaveletTransform<double>::Workspace workspace(wt);
+  int sizes[4] = {4096, 4096, 1000, 4096}, channels[4] = {1, 1, 3, 2};
+  for (int i=0; i<4; i++) {
+    int N = sizes[i], C = channels[i];
+    Eigen::MatrixXd signal = Eigen::MatrixXd::Random(N, C);
+    Eigen::MatrixXcd ref(N, 12*C), out(N, 12*C);
+    wt(signal, ref);
+    wt(signal, out, workspace);
+    UT_ASSERT((out-ref).cwiseAbs().maxCoeff() < 1e-12);
+    Eigen::MatrixXcd csignal = signal.cast<std::complex<double> >();
+    wt(csignal, out, workspace);
+    UT_ASSERT((out-ref).cwiseAbs().maxCoeff() < 1e-12);
+  }
+  // A workspace is bound to the filter bank of its transform, which is shared by identical
+  // transforms (see FilterBankCache)
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(100);
+  Eigen::MatrixXcd out(100, 12);
+  GenericWaveletTransform<double> same(Morlet(), scales, true);
+  same(signal, out, workspace);
+  GenericWaveletTransform<double> other(Morlet(3), scales, true);
+  bool thrown = false;
+  try { other(signal, out, workspace); } catch (ValueError &err) { thrown = true; }
+  UT_ASSERT(thrown);
+}
+
+void
+WaveletTransformTest::testSaveLoad() {
+  // Wavelets are reconstructed from their identifiers
+  Wavelet wavelets[4] = { Morlet(2.5), RegMorlet(1./3), Cauchy(16), RegCauchy(0.7) };
+  for (int i=0; i<4; i++) {
+    Wavelet wavelet = Wavelet::fromIdentifier(wavelets[i].identifier());
+    UT_ASSERT_EQUAL(wavelet.identifier(), wavelets[i].identifier());
+    UT_ASSERT_EQUAL(wavelet.evalAnalysis(0.3), wavelets[i].evalAnalysis(0.3));
+  }
+  UT_ASSERT_THROW(Wavelet::fromIdentifier("Morlet(alpha=2)"), ValueError);
+
+  // A loaded transform (spectral and time-domain kernels) yields identical results
+  Eigen::VectorXd scales(24);
+  for (int j=0; j<24; j++) { scales(j) = 4*std::pow(1.2, j); }
+  Eigen::VectorXd signal = Eigen::VectorXd::Random(2000);
+  bool causal[2] = { false, true };
+  for (int i=0; i<2; i++) {
+    GenericWaveletTransform<double> wt(Morlet(), scales, true, true, causal[i]);
+    std::stringstream buffer;
+    wt.save(buffer);
+    FilterBankCache::clear();
+    GenericWaveletTransform<double> loaded(buffer);
+    UT_ASSERT(loaded.causal() == causal[i]);
+    UT_ASSERT((loaded.scales()-wt.scales()).cwiseAbs().maxCoeff() == 0);
+    UT_ASSERT((loaded.groupDelays()-wt.groupDelays()).cwiseAbs().maxCoeff() == 0);
+    Eigen::MatrixXcd expected(2000, 24), result(2000, 24);
+    wt(signal, expected); loaded(signal, result);
+    UT_ASSERT((result-expected).cwiseAbs().maxCoeff() == 0);
+    // The loaded filter bank is not cached, i.e., not used by identical transforms
+    GenericWaveletTransform<double> other(Morlet(), scales, true, true, causal[i]);
+    UT_ASSERT(other.filterBank() != loaded.filterBank());
+  }
+
+  // Other precisions, formats and truncated files are rejected
+  GenericWaveletTransform<double> wt(Cauchy(), scales);
+  std::stringstream buffer;
+  wt.save(buffer);
+  std::string state = buffer.str();
+  std::istringstream single(state);
+  UT_ASSERT_THROW(GenericWaveletTransform<float> tmp(single), IOError);
+  std::istringstream truncated(state.substr(0, state.size()/2));
+  UT_ASSERT_THROW(GenericWaveletTransform<double> tmp(truncated), IOError);
+  std::istringstream invalid("WTFB" + state.substr(4));
+  UT_ASSERT_THROW(GenericWaveletTransform<double> tmp(invalid), IOError);
+
+  // Corrupt sizes are rejected before allocating them
+  const uint64_t huge = uint64_t(1) << 60;
+  std::string scaleCount = state;
+  std::memcpy(&scaleCount[24+wt.wavelet().identifier().size()], &huge, sizeof(huge));
+  std::istringstream badScales(scaleCount);
+  UT_ASSERT_THROW(GenericWaveletTransform<double> tmp(badScales), IOError);
+  size_t bank = state.find("WTFB");
+  UT_ASSERT(std::string::npos != bank);
+  for (size_t offset=24; offset<=32; offset+=8) {
+    std::string groupSize = state;
+    std::memcpy(&groupSize[bank+offset], &huge, sizeof(huge));
+    std::istringstream badGroup(groupSize);
+    UT_ASSERT_THROW(GenericWaveletTransform<double> tmp(badGroup), IOError);
+  }
+
+  // Save to and load from a file
+  const char *filename = "wavelettransformtest_saved.wt";
+  wt.save(filename);
+  GenericWaveletTransform<double> loaded = GenericWaveletTransform<double>::load(filename);
+  std::remove(filename);
+  UT_ASSERT_EQUAL(loaded.wavelet().identifier(), wt.wavelet().identifier());
+  UT_ASSERT_EQUAL(loaded.filterBank()->memory(), wt.filterBank()->memory());
+}
+
+
 UnitTest::TestSuite *
 WaveletTransformTest::suite() {
   UnitTest::TestSuite *suite = new UnitTest::TestSuite("Wavelet Transform Test");
@@ -58,6 +558,34 @@ WaveletTransformTest::suite() {
                    "trafo", &WaveletTransformTest::testTrafo));
   suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
                    "subsample", &WaveletTransformTest::testSubsample));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "single precision", &WaveletTransformTest::testFloat));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "wavelet spectra", &WaveletTransformTest::testSpectrum));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "spectral trafo", &WaveletTransformTest::testSpectralTrafo));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "kernel grouping", &WaveletTransformTest::testGrouping));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "multi-channel transform", &WaveletTransformTest::testChannels));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "concurrent transforms", &WaveletTransformTest::testConcurrent));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "streaming transform", &WaveletTransformTest::testStreaming));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "causal transform", &WaveletTransformTest::testCausal));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "decimated output", &WaveletTransformTest::testDecimated));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "mapped output", &WaveletTransformTest::testMapped));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "block sink", &WaveletTransformTest::testBlockSink));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "output modes", &WaveletTransformTest::testOutputModes));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "workspace reuse", &WaveletTransformTest::testWorkspace));
+  suite->addTest(new UnitTest::TestCaller<WaveletTransformTest>(
+                   "save and load", &WaveletTransformTest::testSaveLoad));
 
   return suite;
 }
@@ -8,6 +8,20 @@ class WaveletTransformTest : public wt::UnitTest::TestCase
 public:
   void testTrafo();
   void testSubsample();
+  void testFloat();
+  void testSpectrum();
+  void testSpectralTrafo();
+  void testGrouping();
+  void testChannels();
+  void testConcurrent();
+  void testStreaming();
+  void testCausal();
+  void testDecimated();
+  void testMapped();
+  void testBlockSink();
+  void testOutputModes();
+  void testWorkspace();
+  void testSaveLoad();
 
 public:
   static wt::UnitTest::TestSuite *suite();